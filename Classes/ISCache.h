@@ -37,10 +37,39 @@
 #import "ISCacheSimpleHandlerFactory.h"
 #import "ISCacheTask.h"
 #import "ISCacheHandlerDelegate.h"
+#import "ISCacheProcessingQueue.h"
+#import "ISCacheStream.h"
+#import "ISCacheBackgroundSession.h"
+#import "ISCacheBackgroundHandler.h"
+#import "ISCacheBackgroundHandlerFactory.h"
+#import "ISCacheRenditionHandlerFactory.h"
+#import "ISCacheRetryPolicy.h"
+#import "ISCachePack.h"
+#import "ISCachePackWriter.h"
+#import "ISCacheTransform.h"
+#import "ISCacheTransformChain.h"
+#import "ISCacheTransformHandlerFactory.h"
+#import "ISCacheInflateTransform.h"
+#import "ISCacheDigestTransform.h"
+#import "ISCacheByteCountTransform.h"
+#import "ISCacheDecryptTransform.h"
+#import "ISCacheUid.h"
+#import "ISCacheAdmissionPolicy.h"
+#import "ISCacheAlwaysAdmitPolicy.h"
+#import "ISCacheSizeAdmissionPolicy.h"
+#import "ISCacheFrequencyAdmissionPolicy.h"
+#import "ISCachePrefetcher.h"
 #import "ISCacheStateFilter.h"
 
 typedef enum {
   ISCacheErrorCancelled,
+  ISCacheErrorHTTPStatus,
+  ISCacheErrorDecodeFailed,
+  ISCacheErrorIncomplete,
+  ISCacheErrorRetryDeferred,
+  ISCacheErrorInvalidPack,
+  ISCacheErrorTransformFailed,
+  ISCacheErrorVerificationFailed,
 } ISCacheError;
 
 // Contexts.
@@ -49,20 +78,88 @@ extern NSString *const ISCacheImageContext;
 
 // Errors.
 extern NSString *const ISCacheErrorDomain;
+extern NSString *const ISCacheErrorStatusCodeKey;
+extern NSString *const ISCacheErrorRetryDateKey;
 
 @interface ISCache : NSObject <ISCacheHandlerUpdater>
 
 @property (nonatomic) BOOL debug;
 @property (nonatomic) BOOL disablesIdleTimer;
 
+// Time for which a fetch continues once no party is interested in the
+// item, allowing it to be picked back up by a quick re-request.
+// Defaults to 0.
+@property NSTimeInterval interestGracePeriod;
+
 + (instancetype)defaultCache;
 + (instancetype)cacheWithIdentifier:(NSString *)identifier;
 - (instancetype)initWithIdentifier:(NSString *)identifier;
 
+// Shared caches may be opened by several processes, such as an
+// application and its extensions, at once. Each item is fetched by a
+// single process; the others observe its progress through the store.
+// If applicationGroup is nil the cache is stored in the application's
+// own container.
++ (instancetype)sharedCacheWithIdentifier:(NSString *)identifier
+                         applicationGroup:(NSString *)applicationGroup;
+- (instancetype)initWithIdentifier:(NSString *)identifier
+                            shared:(BOOL)shared
+                  applicationGroup:(NSString *)applicationGroup;
+
+@property (nonatomic, readonly) BOOL shared;
+@property (nonatomic, readonly) NSString *applicationGroup;
+
+// Time after which a fetch abandoned by another process is taken over.
+// Leases are renewed while fetches are in progress. Defaults to 60s.
+@property (nonatomic) NSTimeInterval leaseDuration;
+
+// Layout of item directories within the cache directory. Changing the
+// layout moves existing items in the background while the cache remains
+// in use. Defaults to ISCacheLayoutFlat.
+@property (nonatomic) ISCacheLayout layout;
+
+// Maximum number of bytes occupied by found items. Once the budget is
+// reached, the least recently used items are evicted to make room for
+// items admitted by the admission policy. Defaults to 0 (unlimited).
+@property (nonatomic) unsigned long long diskBudget;
+
+// Number of bytes occupied by found items, as counted against the disk
+// budget.
+@property (nonatomic, readonly) unsigned long long usedBytes;
+
+// Consulted before a finished item is retained. Defaults to an
+// ISCacheAlwaysAdmitPolicy.
+@property (nonatomic, strong) id<ISCacheAdmissionPolicy> admissionPolicy;
+
+// Optional prefetcher which learns the order in which items are
+// requested and fetches likely successors ahead of time. Defaults to
+// nil.
+@property (nonatomic, strong) ISCachePrefetcher *prefetcher;
+
 - (void)registerFactory:(id<ISCacheHandlerFactory>)factory
              forContext:(NSString *)context;
 - (void)unregisterFactoryForContext:(NSString *)context;
 
+// Compression applied to files written for items in a context.
+// Only affects files created after the compression is set.
+- (void)setCompression:(ISCacheCompression)compression
+            forContext:(NSString *)context;
+- (ISCacheCompression)compressionForContext:(NSString *)context;
+
+// Retry policy applied to failed items in a context. Fetches of items
+// which failed recently fail immediately with ISCacheErrorRetryDeferred
+// until the interval determined by the policy has elapsed. Removing a
+// failed item clears its failures.
+- (void)setRetryPolicy:(ISCacheRetryPolicy *)retryPolicy
+            forContext:(NSString *)context;
+- (ISCacheRetryPolicy *)retryPolicyForContext:(NSString *)context;
+
+// Mounts a pack built by ISCachePackWriter as a read-only layer beneath
+// the cache. Items in the pack are found without being fetched unless
+// the cache already holds them; packs mounted later take precedence.
+- (BOOL)mountPackAtPath:(NSString *)path
+                  error:(NSError **)error;
+
 - (ISCacheItem *)itemForIdentifier:(NSString *)identifier
                            context:(NSString *)context
                        preferences:(NSDictionary *)preferences;
@@ -25,7 +25,7 @@
 #import <ISUtilities/UIKit+ISUtilities.h>
 #import "ISCacheSimpleHandlerFactory.h"
 #import "ISCacheStore.h"
-#import "NSString+Hashes.h"
+#import "ISCacheUid.h"
 #import "ISCachePrivate.h"
 #import "ISCacheItemPrivate.h"
 
@@ -35,40 +35,122 @@ NSString *const ISCacheImageContext = @"Image";
 
 // Errors.
 NSString *const ISCacheErrorDomain = @"ISCacheErrorDomain";
+NSString *const ISCacheErrorStatusCodeKey = @"ISCacheErrorStatusCodeKey";
+NSString *const ISCacheErrorRetryDateKey = @"ISCacheErrorRetryDateKey";
+
+static NSString *const kDefaultCacheIdentifier = @"uk.co.inseven.cache.store";
+
+// Shared caches.
+static NSString *const kSharedCacheNotificationFormat = @"uk.co.inseven.cache.%@.didChange";
+static const NSTimeInterval kDefaultLeaseDuration = 60.0;
+static const NSTimeInterval kBusyTimeout = 5.0;
+
+static void ISCacheSharedStoreDidChange(CFNotificationCenterRef center,
+                                        void *observer,
+                                        CFStringRef name,
+                                        const void *object,
+                                        CFDictionaryRef userInfo)
+{
+  ISCache *cache = (__bridge ISCache *)observer;
+  [cache _sharedStoreDidChange];
+}
 
 @implementation ISCache
 
 static ISCache *sCache;
 
+// Live caches by identifier.
+static NSMapTable *sCaches;
+
 
 + (id)defaultCache
 {
   static dispatch_once_t onceToken;
   dispatch_once(&onceToken, ^{
-    sCache = [self cacheWithIdentifier:@"uk.co.inseven.cache.store"];
+    sCache = [self cacheWithIdentifier:kDefaultCacheIdentifier];
   });
   return sCache;
 }
 
 
++ (ISCache *)_cacheWithIdentifier:(NSString *)identifier
+{
+  assert([NSThread isMainThread]);
+  ISCache *cache = [sCaches objectForKey:identifier];
+  if (cache == nil &&
+      [identifier isEqualToString:kDefaultCacheIdentifier]) {
+    cache = [self defaultCache];
+  }
+  return cache;
+}
+
+
 + (instancetype)cacheWithIdentifier:(NSString *)identifier
 {
   return [[self alloc] initWithIdentifier:identifier];
 }
 
 
++ (instancetype)sharedCacheWithIdentifier:(NSString *)identifier
+                         applicationGroup:(NSString *)applicationGroup
+{
+  return [[self alloc] initWithIdentifier:identifier
+                                   shared:YES
+                         applicationGroup:applicationGroup];
+}
+
+
+- (instancetype)initWithIdentifier:(NSString *)identifier
+{
+  return [self initWithIdentifier:identifier
+                           shared:NO
+                 applicationGroup:nil];
+}
+
+
 - (instancetype)initWithIdentifier:(NSString *)identifier
+                            shared:(BOOL)shared
+                  applicationGroup:(NSString *)applicationGroup
 {
   self = [super init];
   if (self) {
     self.debug = NO;
+    self.shared = shared;
+    self.applicationGroup = applicationGroup;
+    self.leaseDuration = kDefaultLeaseDuration;
+    self.owner = [[NSProcessInfo processInfo] globallyUniqueString];
+    self.remote = [NSMutableSet set];
+    self.interestGracePeriod = 0.0;
     self.identifier = identifier;
     self.factories = [NSMutableDictionary dictionaryWithCapacity:3];
+    self.compression = [NSMutableDictionary dictionaryWithCapacity:3];
+    self.retryPolicies = [NSMutableDictionary dictionaryWithCapacity:3];
+    self.admissionPolicy = [ISCacheAlwaysAdmitPolicy policy];
+    self.packs = [NSMutableArray arrayWithCapacity:1];
     self.active = [NSMutableDictionary dictionaryWithCapacity:3];
+    self.usage = [NSMutableDictionary dictionary];
+    self.recentlyUsed = [NSMutableOrderedSet orderedSet];
+    self.accessedItems = [NSMutableSet set];
     self.fileManager = [NSFileManager defaultManager];
     
-    // Create the application support directory for the cache.
-    NSString *applicationSupport = [NSSearchPathForDirectoriesInDomains(NSApplicationSupportDirectory, NSUserDomainMask, YES) objectAtIndex:0];
+    // Register the cache to allow background transfers to find it.
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+      sCaches = [NSMapTable strongToWeakObjectsMapTable];
+    });
+    [sCaches setObject:self
+                forKey:identifier];
+    
+    // Create the application support directory for the cache. Caches
+    // shared with extensions live in the application group container.
+    NSString *applicationSupport;
+    if (applicationGroup) {
+      NSURL *container = [self.fileManager containerURLForSecurityApplicationGroupIdentifier:applicationGroup];
+      assert(container != nil);
+      applicationSupport = [NSString pathWithComponents:@[[container path], @"Library", @"Application Support"]];
+    } else {
+      applicationSupport = [NSSearchPathForDirectoriesInDomains(NSApplicationSupportDirectory, NSUserDomainMask, YES) objectAtIndex:0];
+    }
     applicationSupport = [applicationSupport stringByAppendingPathComponent:@"Cache"];
     [self createDirectoryAtPath:applicationSupport];
     
@@ -86,7 +168,16 @@ static ISCache *sCache;
       assert(false);
     }
     
-    // TODO The uid shoudl be unique?
+    // Shared caches use write-ahead logging to allow readers in one
+    // process to proceed while another writes, and wait for locks
+    // held by other processes rather than failing.
+    if (self.shared) {
+      FMResultSet *journal = [self.db executeQuery:@"PRAGMA journal_mode = WAL"];
+      [journal next];
+      [journal close];
+      [self.db setMaxBusyRetryTimeInterval:kBusyTimeout];
+    }
+    
     if (![self.db executeUpdate:
           @"CREATE TABLE IF NOT EXISTS items ("
           @"    id                   INTEGER PRIMARY KEY AUTOINCREMENT NOT NULL,"
@@ -99,7 +190,14 @@ static ISCache *sCache;
           @"    bytesExpectedToRead  INTEGER NOT NULL,"
           @"    filename             TEXT NOT NULL DEFAULT '',"
           @"    preferences          TEXT NOT NULL DEFAULT '',"
-          @"    userInfo             TEXT NOT NULL DEFAULT ''"
+          @"    userInfo             TEXT NOT NULL DEFAULT '',"
+          @"    compression          INTEGER NOT NULL DEFAULT 0,"
+          @"    logicalBytes         INTEGER NOT NULL DEFAULT 0,"
+          @"    storedBytes          INTEGER NOT NULL DEFAULT 0,"
+          @"    failures             INTEGER NOT NULL DEFAULT 0,"
+          @"    retryAfter           REAL NOT NULL DEFAULT 0,"
+          @"    sequence             INTEGER NOT NULL DEFAULT 0,"
+          @"    accessed             REAL NOT NULL DEFAULT 0"
           @");"
           ]) {
       NSLog(@"Unable to create database :(!");
@@ -107,17 +205,121 @@ static ISCache *sCache;
       assert(false);
     }
     
+    if (![self.db executeUpdate:
+          @"CREATE TABLE IF NOT EXISTS files ("
+          @"    id                   INTEGER PRIMARY KEY AUTOINCREMENT NOT NULL,"
+          @"    uid                  TEXT NOT NULL,"
+          @"    name                 TEXT NOT NULL,"
+          @"    compression          INTEGER NOT NULL DEFAULT 0,"
+          @"    logicalBytes         INTEGER NOT NULL DEFAULT 0,"
+          @"    storedBytes          INTEGER NOT NULL DEFAULT 0,"
+          @"    UNIQUE (uid, name)"
+          @");"
+          ]) {
+      NSLog(@"Unable to create files table");
+      assert(false);
+    }
+    
+    // Leases record which process is fetching an item.
+    if (![self.db executeUpdate:
+          @"CREATE TABLE IF NOT EXISTS leases ("
+          @"    uid                  TEXT PRIMARY KEY NOT NULL,"
+          @"    owner                TEXT NOT NULL,"
+          @"    expires              REAL NOT NULL"
+          @");"
+          ]) {
+      NSLog(@"Unable to create leases table");
+      assert(false);
+    }
+    
+    // Transitions record the order in which items are requested.
+    if (![self.db executeUpdate:
+          @"CREATE TABLE IF NOT EXISTS transitions ("
+          @"    context              TEXT NOT NULL,"
+          @"    source               TEXT NOT NULL,"
+          @"    target               TEXT NOT NULL,"
+          @"    count                INTEGER NOT NULL DEFAULT 0,"
+          @"    PRIMARY KEY (context, source, target)"
+          @");"
+          ]) {
+      NSLog(@"Unable to create transitions table");
+      assert(false);
+    }
+    
+    // Upgrade databases created by earlier versions.
+    [self addColumn:@"compression"
+         definition:@"INTEGER NOT NULL DEFAULT 0"];
+    [self addColumn:@"logicalBytes"
+         definition:@"INTEGER NOT NULL DEFAULT 0"];
+    [self addColumn:@"storedBytes"
+         definition:@"INTEGER NOT NULL DEFAULT 0"];
+    [self addColumn:@"failures"
+         definition:@"INTEGER NOT NULL DEFAULT 0"];
+    [self addColumn:@"retryAfter"
+         definition:@"REAL NOT NULL DEFAULT 0"];
+    [self addColumn:@"sequence"
+         definition:@"INTEGER NOT NULL DEFAULT 0"];
+    [self addColumn:@"accessed"
+         definition:@"REAL NOT NULL DEFAULT 0"];
+    
+    // Items are unique by uid. Databases created by earlier versions
+    // may hold duplicates, of which the most recent is kept.
+    if (![self indexExists:@"items_uid"]) {
+      [self.db executeUpdate:@"DELETE FROM items WHERE id NOT IN (SELECT MAX(id) FROM items GROUP BY uid)"];
+    }
+    if (![self.db executeUpdate:@"CREATE UNIQUE INDEX IF NOT EXISTS items_uid ON items (uid)"]) {
+      NSLog(@"Unable to create uid index");
+      assert(false);
+    }
+    
+    // Shared caches find the rows changed by other processes by their
+    // sequence. The most recent sequence is kept in a single row to
+    // avoid scanning the items when saving.
+    if (![self.db executeUpdate:@"CREATE INDEX IF NOT EXISTS items_sequence ON items (sequence)"]) {
+      NSLog(@"Unable to create sequence index");
+      assert(false);
+    }
+    if (![self.db executeUpdate:
+          @"CREATE TABLE IF NOT EXISTS counter ("
+          @"    id                   INTEGER PRIMARY KEY CHECK (id = 1),"
+          @"    sequence             INTEGER NOT NULL DEFAULT 0"
+          @");"
+          ]) {
+      NSLog(@"Unable to create counter table");
+      assert(false);
+    }
+    [self.db executeUpdate:@"INSERT OR IGNORE INTO counter (id, sequence) SELECT 1, IFNULL(MAX(sequence), 0) FROM items"];
+    
+    // Rows written by other processes after this point are picked up
+    // by subsequent refreshes.
+    self.lastSequence = [self _currentSequence];
+    
+    // Load the files, grouped by item.
+    NSMutableDictionary *files = [NSMutableDictionary dictionary];
+    FMResultSet *f = [self.db executeQuery:@"SELECT * FROM files"];
+    while ([f next]) {
+      NSString *uid = [f stringForColumn:@"uid"];
+      NSMutableArray *itemFiles = files[uid];
+      if (itemFiles == nil) {
+        itemFiles = [NSMutableArray arrayWithCapacity:1];
+        files[uid] = itemFiles;
+      }
+      [itemFiles addObject:[self _fileFromResultSet:f]];
+    }
+    
     // Load all the items from the cache.
     self.store = [ISCacheStore new];
-    FMResultSet *s = [self.db executeQuery:@"SELECT * FROM items"];
+    FMResultSet *s = [self.db executeQuery:@"SELECT * FROM items ORDER BY accessed"];
     int count = 0;
     while ([s next]) {
       ISCacheItem *item =
       [[ISCacheItem alloc] _initWithResultSet:s
+                                        files:files[[s stringForColumn:@"uid"]]
                                          root:self.documentsPath
                                         cache:self];
       item.fmdb = self.db;
       [self.store addItem:item];
+      [self _accountForItem:item];
       count++;
     }
     
@@ -143,6 +345,16 @@ static ISCache *sCache;
     [notificationCenter addObserver:self
                            selector:@selector(applicationWillResignActive:)
                                name:UIApplicationWillResignActiveNotification object:nil];
+    
+    // Observe changes made by other processes and keep our leases
+    // alive while fetching.
+    if (self.shared) {
+      [self _startSharing];
+    }
+    
+    // Reconcile the items with the file system in the background.
+    self.reconciler = [[ISCacheReconciler alloc] initWithCache:self];
+    [self.reconciler start];
 
   }
   return self;
@@ -169,10 +381,44 @@ static ISCache *sCache;
 }
 
 
+- (BOOL)indexExists:(NSString *)index
+{
+  FMResultSet *s = [self.db executeQuery:@"SELECT 1 FROM sqlite_master WHERE type = 'index' AND name = ?", index];
+  BOOL exists = [s next];
+  [s close];
+  return exists;
+}
+
+
+// Adds a column to the items table if it is not already present.
+- (void)addColumn:(NSString *)column
+       definition:(NSString *)definition
+{
+  if ([self.db columnExists:column
+            inTableWithName:@"items"]) {
+    return;
+  }
+  NSString *update = [NSString stringWithFormat:
+                      @"ALTER TABLE items ADD COLUMN %@ %@",
+                      column,
+                      definition];
+  if (![self.db executeUpdate:update]) {
+    NSLog(@"Unable to add column %@ to database", column);
+    assert(false);
+  }
+}
+
+
 - (void)dealloc
 {
   NSNotificationCenter *notificationCenter = [NSNotificationCenter defaultCenter];
   [notificationCenter removeObserver:self];
+  [self _saveAccessTimes];
+  if (self.shared) {
+    [self _stopSharing];
+  }
+  [self.reconciler cancel];
+  [self.migrator cancel];
   [self.db close];
 }
 
@@ -226,6 +472,89 @@ static ISCache *sCache;
 }
 
 
+- (void)setPrefetcher:(ISCachePrefetcher *)prefetcher
+{
+  assert([NSThread isMainThread]);
+  _prefetcher = prefetcher;
+  [prefetcher _attachToCache:self];
+}
+
+
+- (void)setLayout:(ISCacheLayout)layout
+{
+  assert([NSThread isMainThread]);
+  if (_layout == layout) {
+    return;
+  }
+  _layout = layout;
+  
+  // Move existing items into the new layout.
+  [self.migrator cancel];
+  self.migrator = [[ISCacheLayoutMigrator alloc] initWithCache:self
+                                                        layout:layout];
+  [self.migrator start];
+}
+
+
+- (void)setCompression:(ISCacheCompression)compression
+            forContext:(NSString *)context
+{
+  assert([NSThread isMainThread]);
+  @synchronized (self.compression) {
+    [self.compression setObject:@(compression)
+                         forKey:context];
+  }
+}
+
+
+- (ISCacheCompression)compressionForContext:(NSString *)context
+{
+  @synchronized (self.compression) {
+    return [[self.compression objectForKey:context] intValue];
+  }
+}
+
+
+- (void)setRetryPolicy:(ISCacheRetryPolicy *)retryPolicy
+            forContext:(NSString *)context
+{
+  assert([NSThread isMainThread]);
+  if (retryPolicy) {
+    [self.retryPolicies setObject:[retryPolicy copy]
+                           forKey:context];
+  } else {
+    [self.retryPolicies removeObjectForKey:context];
+  }
+}
+
+
+- (ISCacheRetryPolicy *)retryPolicyForContext:(NSString *)context
+{
+  assert([NSThread isMainThread]);
+  ISCacheRetryPolicy *retryPolicy = [self.retryPolicies objectForKey:context];
+  if (retryPolicy == nil) {
+    retryPolicy = [ISCacheRetryPolicy defaultPolicy];
+    [self.retryPolicies setObject:retryPolicy
+                           forKey:context];
+  }
+  return retryPolicy;
+}
+
+
+- (BOOL)mountPackAtPath:(NSString *)path
+                  error:(NSError **)error
+{
+  assert([NSThread isMainThread]);
+  ISCachePack *pack = [ISCachePack packWithPath:path
+                                          error:error];
+  if (pack == nil) {
+    return NO;
+  }
+  [self.packs addObject:pack];
+  return YES;
+}
+
+
 // Creates a new item if one doesn't exist.
 - (ISCacheItem *)cacheItem:(NSString *)item
                    context:(NSString *)context
@@ -243,13 +572,29 @@ static ISCache *sCache;
   
   // Return a pre-existing cache item.
   // TODO Why isn't it pre-existing?
-  ISCacheItem *cacheItem = [self.store item:identifier];
+  ISCacheItem *cacheItem = [self itemForUid:identifier];
   if (cacheItem) {
     return cacheItem;
   }
   
+  // Serve the item from a mounted pack if possible.
+  for (ISCachePack *pack in [self.packs reverseObjectEnumerator]) {
+    if ([pack containsUid:identifier]) {
+      cacheItem =
+      [[ISCacheItem alloc] _initWithIdentifier:item
+                                       context:context
+                                   preferences:preferences
+                                           uid:identifier
+                                          pack:pack
+                                         cache:self];
+      [self.store addItem:cacheItem];
+      return cacheItem;
+    }
+  }
+  
   // Create a new info for the file.
-  NSString *path = [self.documentsPath stringByAppendingPathComponent:identifier];
+  NSString *relativePath = ISCachePathForUid(identifier, self.layout);
+  NSString *path = [self.documentsPath stringByAppendingPathComponent:relativePath];
 
   // If there isn't an active cache entry and something exists
   // on the file system, it represents a partial download and
@@ -274,13 +619,19 @@ static ISCache *sCache;
                                preferences:preferences
                                        uid:identifier
                                       root:self.documentsPath
-                                      path:identifier
+                                      path:relativePath
                                      cache:self];
   [self.store addItem:cacheItem];
   
   cacheItem.fmdb = self.db;
   [cacheItem save];
   
+  // Another process may have created the item since it was looked up,
+  // in which case the item takes on the state that process recorded.
+  if (self.shared) {
+    [self _reloadItem:cacheItem];
+  }
+  
   return cacheItem;
 }
 
@@ -292,15 +643,36 @@ static ISCache *sCache;
   assert([NSThread isMainThread]);
   assert(identifier != nil);
   assert(context != nil);
-  return [self cacheItem:identifier
-                 context:context
-             preferences:preferences];
+  ISCacheItem *cacheItem = [self cacheItem:identifier
+                                   context:context
+                               preferences:preferences];
+  
+  // Record the request for eviction, admission and prefetching
+  // decisions. Prefetches look items up directly and are not recorded.
+  [cacheItem _recordAccess];
+  [self.accessedItems addObject:cacheItem.uid];
+  if ([self.recentlyUsed containsObject:cacheItem.uid]) {
+    [self.recentlyUsed removeObject:cacheItem.uid];
+    [self.recentlyUsed addObject:cacheItem.uid];
+  }
+  [self.admissionPolicy recordAccessForItem:cacheItem];
+  [self.prefetcher _recordRequestForItem:cacheItem];
+  
+  return cacheItem;
 }
 
 
 - (ISCacheItem *)itemForUid:(NSString *)uid
 {
-  return [self.store item:uid];
+  ISCacheItem *item = [self.store item:uid];
+  
+  // Another process may have created the item since we last refreshed.
+  if (item == nil &&
+      self.shared) {
+    item = [self _loadItemForUid:uid];
+  }
+  
+  return item;
 }
 
 
@@ -316,9 +688,46 @@ static ISCache *sCache;
                                    context:context
                                preferences:preferences];
   
+  // Fail fast without touching the network if the item failed
+  // recently.
+  NSDate *retryDate = cacheItem.retryDate;
+  if (cacheItem.state == ISCacheItemStateNotFound &&
+      [retryDate timeIntervalSinceNow] > 0) {
+    [self log:@"fetch: %@ deferred until %@", identifier, retryDate];
+    NSMutableDictionary *userInfo =
+    [NSMutableDictionary dictionaryWithObject:retryDate
+                                       forKey:ISCacheErrorRetryDateKey];
+    NSError *underlyingError = cacheItem.lastError;
+    if ([underlyingError.domain isEqualToString:ISCacheErrorDomain] &&
+        underlyingError.code == ISCacheErrorRetryDeferred) {
+      underlyingError = underlyingError.userInfo[NSUnderlyingErrorKey];
+    }
+    if (underlyingError) {
+      [userInfo setObject:underlyingError
+                   forKey:NSUnderlyingErrorKey];
+    }
+    NSError *error =
+    [NSError errorWithDomain:ISCacheErrorDomain
+                        code:ISCacheErrorRetryDeferred
+                    userInfo:userInfo];
+    [cacheItem _transitionToError:error];
+    return cacheItem;
+  }
+  
   // Download the cache item if necessary.
   if (cacheItem.state == ISCacheItemStateNotFound) {
         
+    // Shared caches only fetch items which no other process is
+    // fetching; otherwise the item is marked as in progress until the
+    // other process records the outcome.
+    if (self.shared &&
+        ![self _acquireLeaseForItem:cacheItem]) {
+      [self log:@"fetch: %@ in progress in another process", identifier];
+      [cacheItem _transitionToInProgress];
+      [self.remote addObject:cacheItem.uid];
+      return cacheItem;
+    }
+    
     // If the item doesn't exist and isn't in progress, fetch it.
     id<ISCacheHandler> handler = [self handlerForContext:context
                                              preferences:preferences];
@@ -337,6 +746,30 @@ static ISCache *sCache;
 }
 
 
+// Adopts an item whose fetch was started by a previous process.
+// Returns NO if the item is already found or being fetched.
+- (BOOL)_adoptItem:(ISCacheItem *)cacheItem
+           handler:(id<ISCacheHandler>)handler
+{
+  assert([NSThread isMainThread]);
+  if (cacheItem.state == ISCacheItemStateFound ||
+      [self.active objectForKey:cacheItem.uid] != nil) {
+    return NO;
+  }
+  
+  // Reconciliation may already have reset the item.
+  if (cacheItem.state == ISCacheItemStateNotFound) {
+    [cacheItem _transitionToInProgress];
+    [cacheItem save];
+  }
+  
+  [self.active setObject:handler
+                  forKey:cacheItem.uid];
+  [self _fetchDidStart];
+  return YES;
+}
+
+
 - (void)removeItems:(NSArray *)items
 {
   assert([NSThread isMainThread]);
@@ -348,7 +781,14 @@ static ISCache *sCache;
 
 - (void)removeItem:(ISCacheItem *)cacheItem
 {
-  if (cacheItem.state == ISCacheItemStateFound) {
+  [self.prefetcher _removeTransitionsForItem:cacheItem];
+  
+  if (cacheItem.packed) {
+    
+    // Pack items are read-only.
+    [self log:@"removeItem:%@ -> item is packed, ignoring", cacheItem.uid];
+    
+  } else if (cacheItem.state == ISCacheItemStateFound) {
     
     // Reset the cache item state.
     [cacheItem _transitionToNotFound];
@@ -362,7 +802,10 @@ static ISCache *sCache;
   } else {
     
     // If the item doesn't exist and isn't in progress, it is
-    // sufficient to do nothing.
+    // sufficient to clear any failures to allow it to be refetched.
+    if ([cacheItem _resetFailures]) {
+      [cacheItem save];
+    }
     
   }
 }
@@ -423,6 +866,10 @@ static ISCache *sCache;
 
 - (BOOL)purge
 {
+  // Stop any outstanding reconciliation or migration.
+  [self.reconciler cancel];
+  [self.migrator cancel];
+  
   // Close the database.
   [self.db close];
   self.db = nil;
@@ -479,6 +926,20 @@ static ISCache *sCache;
   });
   
   [self.active removeObjectForKey:item.uid];
+  if (self.shared) {
+    [self _releaseLeaseForItem:item];
+  }
+  
+  // Layout migrations skip items which are being fetched, so they are
+  // moved once the fetch completes; failed and cancelled fetches have
+  // nothing to move.
+  NSString *path = ISCachePathForUid(item.uid, self.layout);
+  if (!item.packed &&
+      item.state == ISCacheItemStateFound &&
+      ![item.path isEqualToString:path]) {
+    [item _moveToPath:path];
+  }
+  
   [self _fetchDidFinish];
   [self endBackgroundTask];
 }
@@ -544,18 +1005,7 @@ static ISCache *sCache;
                         context:(NSString *)context
                     preferences:(NSDictionary *)preferences
 {
-  if (preferences) {
-    return [[NSString stringWithFormat:
-             @"%@:%@(%@)",
-             context,
-             item,
-             preferences] md5];
-  } else {
-    return [[NSString stringWithFormat:
-             @"%@:%@",
-             context,
-             item] md5];
-  }
+  return ISCacheUidForItem(item, context, preferences);
 }
 
 
@@ -569,9 +1019,125 @@ static ISCache *sCache;
 - (void)itemDidFinish:(ISCacheItem *)item
 {
   [self log:@"itemDidFinish:%@", item.uid];
+  
+  // Items which are not admitted are marked transient before clients
+  // are notified, and are removed once nobody is interested in them.
+  if (![self _admitItem:item]) {
+    [self log:@"itemDidFinish:%@ -> item not admitted", item.uid];
+    [item _markTransient];
+  }
   [item _transitionToFound];
   [item save];
   [self cleanupForItem:item];
+  if (item.transient &&
+      item.interestCount == 0) {
+    dispatch_async(dispatch_get_main_queue(), ^{
+      if (item.transient &&
+          item.interestCount == 0) {
+        [self removeItem:item];
+      }
+    });
+  }
+}
+
+
+#pragma mark - Admission
+
+
+// Updates the running total of bytes used by found items and the
+// recently used index to reflect the item's state. Items which become
+// found are treated as the most recently used.
+- (void)_accountForItem:(ISCacheItem *)item
+{
+  BOOL counted =
+    (item.state == ISCacheItemStateFound &&
+     !item.packed &&
+     !item.transient);
+  unsigned long long bytes = counted ? item.savedStoredLength : 0;
+  NSNumber *previous = self.usage[item.uid];
+  self.usedBytes = self.usedBytes - [previous unsignedLongLongValue] + bytes;
+  if (counted) {
+    self.usage[item.uid] = @(bytes);
+    if (previous == nil) {
+      [self.recentlyUsed addObject:item.uid];
+    }
+  } else if (previous) {
+    [self.usage removeObjectForKey:item.uid];
+    [self.recentlyUsed removeObject:item.uid];
+  }
+}
+
+
+// Writes the access times recorded since the last call in a single
+// transaction.
+- (void)_saveAccessTimes
+{
+  if ([self.accessedItems count] == 0) {
+    return;
+  }
+  [self.db beginTransaction];
+  for (NSString *uid in self.accessedItems) {
+    ISCacheItem *item = [self.store item:uid];
+    if (item.accessed == nil ||
+        item.packed) {
+      continue;
+    }
+    [self.db executeUpdate:@"UPDATE items SET accessed = ? WHERE uid = ?", @([item.accessed timeIntervalSince1970]), uid];
+  }
+  [self.db commit];
+  [self.accessedItems removeAllObjects];
+}
+
+
+
+// Consults the admission policy and, if the cache has a disk budget,
+// evicts the least recently used items necessary to make room for the
+// item. Items which are in use are never evicted.
+- (BOOL)_admitItem:(ISCacheItem *)item
+{
+  assert([NSThread isMainThread]);
+  if (self.diskBudget == 0) {
+    return [self.admissionPolicy shouldAdmitItem:item
+                                          victim:nil];
+  }
+  
+  unsigned long long length = item.storedLength;
+  unsigned long long used = self.usedBytes - [self.usage[item.uid] unsignedLongLongValue];
+  if (used + length <= self.diskBudget) {
+    return [self.admissionPolicy shouldAdmitItem:item
+                                          victim:nil];
+  }
+  
+  // Victims are taken from the least recently used end of the index,
+  // skipping items which are in use.
+  NSMutableArray *victims = [NSMutableArray array];
+  for (NSString *uid in self.recentlyUsed) {
+    if (used + length <= self.diskBudget) {
+      break;
+    }
+    ISCacheItem *victim = [self.store item:uid];
+    if (victim == nil ||
+        victim == item ||
+        victim.interestCount > 0 ||
+        [self.active objectForKey:uid] != nil) {
+      continue;
+    }
+    if (![self.admissionPolicy shouldAdmitItem:item
+                                        victim:victim]) {
+      return NO;
+    }
+    [victims addObject:victim];
+    used -= [self.usage[uid] unsignedLongLongValue];
+  }
+  if (used + length > self.diskBudget) {
+    return NO;
+  }
+  
+  for (ISCacheItem *victim in victims) {
+    [self log:@"Evicting item %@", victim.uid];
+    [self removeItem:victim];
+  }
+  return YES;
 }
 
 
@@ -591,12 +1157,273 @@ static ISCache *sCache;
 didFailWithError:(NSError *)error
 {
   [self log:@"item:%@ didFailWithError: %@", item.uid, error];
+  
+  // Hold the item for the interval determined by the retry policy.
+  // Connectivity failures are not recorded so that items remain
+  // retryable while offline.
+  if (![ISCacheRetryPolicy isConnectivityError:error]) {
+    ISCacheRetryPolicy *retryPolicy = [self retryPolicyForContext:item.context];
+    NSTimeInterval interval =
+    [retryPolicy retryIntervalForError:error
+                              failures:item.failures + 1];
+    [item _recordFailureWithRetryDate:[NSDate dateWithTimeIntervalSinceNow:interval]];
+  }
+  
   [item _transitionToError:error];
   [item save];
   [self cleanupForItem:item];
 }
 
 
+#pragma mark - Shared caches
+
+
+- (void)_startSharing
+{
+  NSString *name = [NSString stringWithFormat:kSharedCacheNotificationFormat, self.identifier];
+  CFNotificationCenterAddObserver(CFNotificationCenterGetDarwinNotifyCenter(),
+                                  (__bridge const void *)self,
+                                  ISCacheSharedStoreDidChange,
+                                  (__bridge CFStringRef)name,
+                                  NULL,
+                                  CFNotificationSuspensionBehaviorDeliverImmediately);
+  
+  // Renew our leases well before they expire, and detect fetches
+  // abandoned by other processes.
+  ISCache *__weak weakSelf = self;
+  self.leaseTimer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, dispatch_get_main_queue());
+  uint64_t interval = (uint64_t)(self.leaseDuration / 3.0 * NSEC_PER_SEC);
+  dispatch_source_set_timer(self.leaseTimer,
+                            dispatch_time(DISPATCH_TIME_NOW, interval),
+                            interval,
+                            interval / 10);
+  dispatch_source_set_event_handler(self.leaseTimer, ^{
+    [weakSelf _renewLeases];
+  });
+  dispatch_resume(self.leaseTimer);
+}
+
+
+- (void)_stopSharing
+{
+  NSString *name = [NSString stringWithFormat:kSharedCacheNotificationFormat, self.identifier];
+  CFNotificationCenterRemoveObserver(CFNotificationCenterGetDarwinNotifyCenter(),
+                                     (__bridge const void *)self,
+                                     (__bridge CFStringRef)name,
+                                     NULL);
+  dispatch_source_cancel(self.leaseTimer);
+  [self.db executeUpdate:@"DELETE FROM leases WHERE owner = ?", self.owner];
+}
+
+
+// Called by items once they have been written to the database.
+- (void)_itemDidSave:(ISCacheItem *)item
+{
+  [self _accountForItem:item];
+  if (self.shared) {
+    NSString *name = [NSString stringWithFormat:kSharedCacheNotificationFormat, self.identifier];
+    CFNotificationCenterPostNotification(CFNotificationCenterGetDarwinNotifyCenter(),
+                                         (__bridge CFStringRef)name,
+                                         NULL,
+                                         NULL,
+                                         true);
+  }
+}
+
+
+// Darwin notifications carry no information, so changes are
+// coalesced into a single refresh.
+- (void)_sharedStoreDidChange
+{
+  assert([NSThread isMainThread]);
+  if (self.refreshPending) {
+    return;
+  }
+  self.refreshPending = YES;
+  dispatch_async(dispatch_get_main_queue(), ^{
+    self.refreshPending = NO;
+    [self _refresh];
+  });
+}
+
+
+// Applies the rows written since the last refresh. Items fetched by
+// this process are left untouched as their state is authoritative.
+- (void)_refresh
+{
+  assert([NSThread isMainThread]);
+  FMResultSet *s = [self.db executeQuery:@"SELECT * FROM items WHERE sequence > ? ORDER BY sequence", @(self.lastSequence)];
+  NSUInteger count = 0;
+  while ([s next]) {
+    self.lastSequence = MAX(self.lastSequence, [s longLongIntForColumn:@"sequence"]);
+    NSString *uid = [s stringForColumn:@"uid"];
+    if ([self.active objectForKey:uid] != nil) {
+      continue;
+    }
+    
+    // Skip rows written by this process.
+    ISCacheItem *item = [self.store item:uid];
+    if (item.sequence == [s longLongIntForColumn:@"sequence"]) {
+      continue;
+    }
+    
+    if (item) {
+      [item _updateWithResultSet:s
+                           files:[self _filesForUid:uid]];
+    } else {
+      item = [self _itemForResultSet:s];
+      [self.store addItem:item];
+    }
+    [self _accountForItem:item];
+    
+    if (item.state == ISCacheItemStateInProgress) {
+      [self.remote addObject:uid];
+    } else {
+      [self.remote removeObject:uid];
+    }
+    count++;
+  }
+  [s close];
+  [self log:@"Refreshed %lu items", (unsigned long)count];
+}
+
+
+- (ISCacheItem *)_loadItemForUid:(NSString *)uid
+{
+  FMResultSet *s = [self.db executeQuery:@"SELECT * FROM items WHERE uid = ?", uid];
+  ISCacheItem *item = nil;
+  if ([s next]) {
+    item = [self _itemForResultSet:s];
+    [self.store addItem:item];
+    [self _accountForItem:item];
+    if (item.state == ISCacheItemStateInProgress) {
+      [self.remote addObject:uid];
+    }
+  }
+  [s close];
+  return item;
+}
+
+
+- (void)_reloadItem:(ISCacheItem *)item
+{
+  FMResultSet *s = [self.db executeQuery:@"SELECT * FROM items WHERE uid = ?", item.uid];
+  if ([s next]) {
+    [item _updateWithResultSet:s
+                         files:[self _filesForUid:item.uid]];
+    [self _accountForItem:item];
+    if (item.state == ISCacheItemStateInProgress) {
+      [self.remote addObject:item.uid];
+    }
+  }
+  [s close];
+}
+
+
+- (ISCacheItem *)_itemForResultSet:(FMResultSet *)resultSet
+{
+  ISCacheItem *item =
+  [[ISCacheItem alloc] _initWithResultSet:resultSet
+                                    files:[self _filesForUid:[resultSet stringForColumn:@"uid"]]
+                                     root:self.documentsPath
+                                    cache:self];
+  item.fmdb = self.db;
+  return item;
+}
+
+
+- (NSArray *)_filesForUid:(NSString *)uid
+{
+  NSMutableArray *files = [NSMutableArray arrayWithCapacity:1];
+  FMResultSet *f = [self.db executeQuery:@"SELECT * FROM files WHERE uid = ?", uid];
+  while ([f next]) {
+    [files addObject:[self _fileFromResultSet:f]];
+  }
+  [f close];
+  return files;
+}
+
+
+- (NSDictionary *)_fileFromResultSet:(FMResultSet *)resultSet
+{
+  return @{@"name": [resultSet stringForColumn:@"name"],
+           @"compression": @([resultSet intForColumn:@"compression"]),
+           @"logicalBytes": @([resultSet unsignedLongLongIntForColumn:@"logicalBytes"])};
+}
+
+
+- (long long)_currentSequence
+{
+  FMResultSet *s = [self.db executeQuery:@"SELECT sequence FROM counter"];
+  long long sequence = 0;
+  if ([s next]) {
+    sequence = [s longLongIntForColumnIndex:0];
+  }
+  [s close];
+  return sequence;
+}
+
+
+// Takes the lease for the item unless another process holds an
+// unexpired lease. The check and the write are a single statement and
+// therefore atomic across processes.
+- (BOOL)_acquireLeaseForItem:(ISCacheItem *)item
+{
+  NSTimeInterval now = [[NSDate date] timeIntervalSince1970];
+  if (![self.db executeUpdate:@"INSERT OR REPLACE INTO leases (uid, owner, expires) SELECT ?, ?, ? WHERE NOT EXISTS (SELECT 1 FROM leases WHERE uid = ? AND owner != ? AND expires > ?)", item.uid, self.owner, @(now + self.leaseDuration), item.uid, self.owner, @(now)]) {
+    return NO;
+  }
+  return [self.db changes] > 0;
+}
+
+
+- (void)_releaseLeaseForItem:(ISCacheItem *)item
+{
+  [self.db executeUpdate:@"DELETE FROM leases WHERE uid = ? AND owner = ?", item.uid, self.owner];
+}
+
+
+// Returns YES if another process holds an unexpired lease for the item.
+- (BOOL)_isLeasedElsewhere:(ISCacheItem *)item
+{
+  FMResultSet *s = [self.db executeQuery:@"SELECT 1 FROM leases WHERE uid = ? AND owner != ? AND expires > ?", item.uid, self.owner, @([[NSDate date] timeIntervalSince1970])];
+  BOOL leased = [s next];
+  [s close];
+  return leased;
+}
+
+
+- (void)_renewLeases
+{
+  assert([NSThread isMainThread]);
+  if ([self.active count] > 0) {
+    NSTimeInterval expires = [[NSDate date] timeIntervalSince1970] + self.leaseDuration;
+    [self.db executeUpdate:@"UPDATE leases SET expires = ? WHERE owner = ?", @(expires), self.owner];
+  }
+  
+  // Items whose fetching process has gone away are reset and fetched
+  // again by this process.
+  if ([self.remote count] == 0) {
+    return;
+  }
+  [self _refresh];
+  for (NSString *uid in [self.remote allObjects]) {
+    ISCacheItem *item = [self.store item:uid];
+    if (item == nil ||
+        item.state != ISCacheItemStateInProgress) {
+      [self.remote removeObject:uid];
+    } else if (![self _isLeasedElsewhere:item]) {
+      [self log:@"Fetch of %@ abandoned by another process", uid];
+      [self.remote removeObject:uid];
+      [item _transitionToNotFound];
+      [self fetchItemForIdentifier:item.identifier
+                           context:item.context
+                       preferences:item.preferences];
+    }
+  }
+}
+
+
 #pragma mark - NSNotificationCenter
 
 
@@ -605,6 +1432,7 @@ didFailWithError:(NSError *)error
   // TODO Is this called by the completion handler or do we
   // need to defer the completion through an observer?
   [self log:@"applicationWillResignActive:"];
+  [self _saveAccessTimes];
   [self beginBackgroundTask];
 }
 
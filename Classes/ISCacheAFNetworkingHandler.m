@@ -48,13 +48,21 @@
   NSURLRequest *request =
   [NSURLRequest requestWithURL:URL cachePolicy:NSURLRequestReloadIgnoringLocalAndRemoteCacheData timeoutInterval:60.0];
   
+  // The download is moved into place by AFNetworking, bypassing
+  // compression, so the file is stored as downloaded.
+  __block ISCacheFile *file;
   self.downloadTask = [self.manager downloadTaskWithRequest:request progress:nil destination:^NSURL *(NSURL *targetPath, NSURLResponse *response) {
-    return [NSURL fileURLWithPath:[self.cacheItem file:[response suggestedFilename]].path];
+    file = [self.cacheItem file:[response suggestedFilename]
+                    compression:ISCacheCompressionNone];
+    return [NSURL fileURLWithPath:file.path];
   } completionHandler:^(NSURLResponse *response, NSURL *filePath, NSError *error) {
     if (error) {
       [updater item:cacheItem didFailWithError:error];
       [self.downloadTask resume];
     } else {
+      unsigned long long length = file.length;
+      cacheItem.totalBytesExpectedToRead = length;
+      cacheItem.totalBytesRead = length;
       [updater itemDidFinish:cacheItem];
     }
   }];
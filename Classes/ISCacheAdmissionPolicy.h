@@ -0,0 +1,42 @@
+//
+// Copyright (c) 2013-2014 InSeven Limited.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+@class ISCacheItem;
+
+// Decides whether finished items are retained by the cache. Caches
+// with a disk budget consult the policy for each item which would be
+// evicted to make room, least recently used first. Rejected items are
+// still delivered to waiting clients but are marked transient and
+// removed once no party is interested in them.
+@protocol ISCacheAdmissionPolicy <NSObject>
+
+// Called on the main thread whenever a client requests an item.
+- (void)recordAccessForItem:(ISCacheItem *)item;
+
+// Returns YES if the item should be admitted at the expense of the
+// victim. victim is nil if the item fits without evicting anything.
+- (BOOL)shouldAdmitItem:(ISCacheItem *)item
+                 victim:(ISCacheItem *)victim;
+
+@end
@@ -0,0 +1,184 @@
+//
+// Copyright (c) 2013-2014 InSeven Limited.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import "ISCacheBackgroundHandler.h"
+#import "ISCacheBackgroundSessionPrivate.h"
+#import "ISCache.h"
+#import "ISCachePrivate.h"
+#import "ISCacheItemPrivate.h"
+
+@interface ISCacheBackgroundHandler ()
+
+@property (nonatomic, strong) ISCacheBackgroundSession *session;
+@property (nonatomic, strong) NSURLSessionDownloadTask *task;
+@property (nonatomic, strong) ISCacheItem *cacheItem;
+@property (nonatomic, strong) ISCache *cache;
+@property (nonatomic, weak) id<ISCacheHandlerUpdater> updater;
+@property (nonatomic, strong) NSError *error;
+@property (nonatomic) BOOL cancelled;
+
+@end
+
+@implementation ISCacheBackgroundHandler
+
+
+- (id)init
+{
+  return [self initWithSession:[ISCacheBackgroundSession sharedSession]];
+}
+
+
+- (id)initWithSession:(ISCacheBackgroundSession *)session
+{
+  self = [super init];
+  if (self) {
+    self.session = session;
+  }
+  return self;
+}
+
+
+// Used to reattach a transfer started by a previous process.
+- (id)_initWithSession:(ISCacheBackgroundSession *)session
+                  task:(NSURLSessionDownloadTask *)task
+             cacheItem:(ISCacheItem *)cacheItem
+{
+  self = [self initWithSession:session];
+  if (self) {
+    self.task = task;
+    self.cacheItem = cacheItem;
+    self.updater = cacheItem.cache;
+    
+    // Caches reopened for a transfer are only held weakly by the
+    // session, so the handler keeps the cache open until it completes.
+    self.cache = cacheItem.cache;
+  }
+  return self;
+}
+
+
+- (void)fetchItem:(ISCacheItem *)info
+          updater:(id<ISCacheHandlerUpdater>)updater
+{
+  self.updater = updater;
+  self.cacheItem = info;
+  self.task = [self.session downloadTaskForItem:info
+                                        handler:self];
+  [self.task resume];
+}
+
+
+- (void)cancel
+{
+  self.cancelled = YES;
+  [self.task cancel];
+  [self.updater itemDidCancel:self.cacheItem];
+}
+
+
+- (void)finalize
+{
+}
+
+
+#pragma mark - Session events
+
+
+- (void)_didWriteData:(int64_t)totalBytesWritten
+    totalBytesExpected:(int64_t)totalBytesExpectedToWrite
+{
+  if (self.cancelled ||
+      self.cacheItem.state != ISCacheItemStateInProgress) {
+    return;
+  }
+  
+  if (totalBytesExpectedToWrite > 0) {
+    self.cacheItem.totalBytesExpectedToRead = totalBytesExpectedToWrite;
+  }
+  self.cacheItem.totalBytesRead = totalBytesWritten;
+}
+
+
+- (void)_didFinishDownloadingToURL:(NSURL *)location
+{
+  if (self.cancelled) {
+    return;
+  }
+  
+  NSURLResponse *response = self.task.response;
+  if ([response isKindOfClass:[NSHTTPURLResponse class]]) {
+    NSInteger statusCode = [(NSHTTPURLResponse *)response statusCode];
+    if (statusCode >= 400) {
+      self.error =
+      [NSError errorWithDomain:ISCacheErrorDomain
+                          code:ISCacheErrorHTTPStatus
+                      userInfo:@{ISCacheErrorStatusCodeKey: @(statusCode)}];
+      return;
+    }
+  }
+  
+  // Move the download into the item's directory; both live within the
+  // application container so this is a rename rather than a copy. The
+  // file is stored as downloaded as moving it bypasses compression.
+  ISCacheFile *file = [self.cacheItem file:response.suggestedFilename
+                               compression:ISCacheCompressionNone];
+  [file remove];
+  NSFileManager *fileManager = [NSFileManager defaultManager];
+  NSString *parent = [file.path stringByDeletingLastPathComponent];
+  [fileManager createDirectoryAtPath:parent
+         withIntermediateDirectories:YES
+                          attributes:nil
+                               error:nil];
+  NSError *error;
+  if (![fileManager moveItemAtURL:location
+                            toURL:[NSURL fileURLWithPath:file.path]
+                            error:&error]) {
+    self.error = error;
+    return;
+  }
+  
+  unsigned long long length = file.length;
+  self.cacheItem.totalBytesExpectedToRead = length;
+  self.cacheItem.totalBytesRead = length;
+}
+
+
+- (void)_didCompleteWithError:(NSError *)error
+{
+  if (self.cancelled) {
+    return;
+  }
+  
+  if (error == nil) {
+    error = self.error;
+  }
+  
+  if (error) {
+    [self.updater item:self.cacheItem
+      didFailWithError:error];
+  } else {
+    [self.updater itemDidFinish:self.cacheItem];
+  }
+}
+
+
+@end
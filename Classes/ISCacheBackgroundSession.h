@@ -0,0 +1,59 @@
+//
+// Copyright (c) 2013-2014 InSeven Limited.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+extern NSString *const ISCacheBackgroundSessionIdentifier;
+
+// Owns the background URL session used by ISCacheBackgroundHandler.
+// Transfers continue while the application is suspended and, on
+// relaunch, completed and outstanding transfers are reattached to
+// their cache items by uid.
+//
+// Applications should forward background session events from their
+// application delegate:
+//
+//   - (void)application:(UIApplication *)application
+//   handleEventsForBackgroundURLSession:(NSString *)identifier
+//     completionHandler:(void (^)())completionHandler
+//   {
+//     [[ISCacheBackgroundSession sharedSession]
+//      handleEventsForBackgroundURLSession:identifier
+//      completionHandler:completionHandler];
+//   }
+@interface ISCacheBackgroundSession : NSObject
+<NSURLSessionDownloadDelegate>
+
+@property (nonatomic, readonly) NSURLSession *session;
+
++ (instancetype)sharedSession;
+- (id)initWithConfiguration:(NSURLSessionConfiguration *)configuration;
+
+- (void)handleEventsForBackgroundURLSession:(NSString *)identifier
+                          completionHandler:(void (^)())completionHandler;
+
+// Stops delivering events for the session; outstanding background
+// transfers continue and will be reattached by the next session
+// created with the same configuration.
+- (void)invalidate;
+
+@end
@@ -0,0 +1,291 @@
+//
+// Copyright (c) 2013-2014 InSeven Limited.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import "ISCacheBackgroundSession.h"
+#import "ISCacheBackgroundSessionPrivate.h"
+#import "ISCache.h"
+#import "ISCachePrivate.h"
+#import "ISCacheItemPrivate.h"
+
+NSString *const ISCacheBackgroundSessionIdentifier = @"uk.co.inseven.cache.background";
+
+// Task description keys.
+static NSString *const kDescriptionCacheKey = @"cache";
+static NSString *const kDescriptionUidKey = @"uid";
+static NSString *const kDescriptionSharedKey = @"shared";
+static NSString *const kDescriptionApplicationGroupKey = @"applicationGroup";
+
+@interface ISCacheBackgroundSession ()
+
+@property (nonatomic, strong) NSURLSession *session;
+@property (nonatomic, strong) NSMutableDictionary *handlers;
+@property (nonatomic, strong) NSMapTable *caches;
+@property (nonatomic, copy) void (^completionHandler)();
+
+@end
+
+@implementation ISCacheBackgroundSession
+
+
++ (instancetype)sharedSession
+{
+  static ISCacheBackgroundSession *sSession;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    // The identifier-based configuration replaces the iOS 7 method
+    // which is deprecated from iOS 8.
+    NSURLSessionConfiguration *configuration;
+    if ([NSURLSessionConfiguration respondsToSelector:@selector(backgroundSessionConfigurationWithIdentifier:)]) {
+      configuration = [NSURLSessionConfiguration backgroundSessionConfigurationWithIdentifier:ISCacheBackgroundSessionIdentifier];
+    } else {
+      configuration = [NSURLSessionConfiguration backgroundSessionConfiguration:ISCacheBackgroundSessionIdentifier];
+    }
+    sSession = [[self alloc] initWithConfiguration:configuration];
+  });
+  return sSession;
+}
+
+
+- (id)initWithConfiguration:(NSURLSessionConfiguration *)configuration
+{
+  self = [super init];
+  if (self) {
+    self.handlers = [NSMutableDictionary dictionaryWithCapacity:3];
+    self.caches = [NSMapTable strongToWeakObjectsMapTable];
+    
+    // Delegate callbacks are delivered on the main queue as the cache
+    // and its items may only be mutated on the main thread.
+    self.session =
+    [NSURLSession sessionWithConfiguration:configuration
+                                  delegate:self
+                             delegateQueue:[NSOperationQueue mainQueue]];
+    
+    // Reattach any transfers which were started by a previous process.
+    [self.session getTasksWithCompletionHandler:
+     ^(NSArray *dataTasks, NSArray *uploadTasks, NSArray *downloadTasks) {
+       dispatch_async(dispatch_get_main_queue(), ^{
+         for (NSURLSessionDownloadTask *task in downloadTasks) {
+           [self _handlerForTask:task];
+         }
+       });
+     }];
+  }
+  return self;
+}
+
+
+- (void)handleEventsForBackgroundURLSession:(NSString *)identifier
+                          completionHandler:(void (^)())completionHandler
+{
+  assert([NSThread isMainThread]);
+  if (![identifier isEqualToString:self.session.configuration.identifier]) {
+    return;
+  }
+  self.completionHandler = completionHandler;
+}
+
+
+- (void)invalidate
+{
+  [self.session finishTasksAndInvalidate];
+}
+
+
+- (NSURLSessionDownloadTask *)downloadTaskForItem:(ISCacheItem *)item
+                                          handler:(ISCacheBackgroundHandler *)handler
+{
+  assert([NSThread isMainThread]);
+  NSURL *URL = [NSURL URLWithString:item.identifier];
+  NSURLRequest *request =
+  [NSURLRequest requestWithURL:URL
+                   cachePolicy:NSURLRequestReloadIgnoringLocalAndRemoteCacheData
+               timeoutInterval:60.0];
+  NSURLSessionDownloadTask *task = [self.session downloadTaskWithRequest:request];
+  
+  // The task description identifies the item across launches.
+  task.taskDescription = [self _descriptionForItem:item];
+  
+  [self.handlers setObject:handler
+                    forKey:@(task.taskIdentifier)];
+  return task;
+}
+
+
+- (void)removeTask:(NSURLSessionTask *)task
+{
+  [self.handlers removeObjectForKey:@(task.taskIdentifier)];
+}
+
+
+#pragma mark - Utilities
+
+
+// Describes the item and the configuration of its cache; the cache
+// must be reopened with the same configuration on relaunch as shared
+// caches live in a different container.
+- (NSString *)_descriptionForItem:(ISCacheItem *)item
+{
+  NSMutableDictionary *description =
+  [NSMutableDictionary dictionaryWithDictionary:@{kDescriptionCacheKey: item.cache.identifier,
+                                                  kDescriptionUidKey: item.uid,
+                                                  kDescriptionSharedKey: @(item.cache.shared)}];
+  if (item.cache.applicationGroup) {
+    [description setObject:item.cache.applicationGroup
+                    forKey:kDescriptionApplicationGroupKey];
+  }
+  NSData *data = [NSJSONSerialization dataWithJSONObject:description
+                                                 options:0
+                                                   error:nil];
+  return [[NSString alloc] initWithData:data
+                               encoding:NSUTF8StringEncoding];
+}
+
+
+// Returns the handler for a task, reattaching the task to its cache
+// item if it was started by a previous process.
+- (ISCacheBackgroundHandler *)_handlerForTask:(NSURLSessionDownloadTask *)task
+{
+  ISCacheBackgroundHandler *handler = [self.handlers objectForKey:@(task.taskIdentifier)];
+  if (handler) {
+    return handler;
+  }
+  
+  ISCacheItem *item = [self _itemForTask:task];
+  if (item == nil) {
+    [task cancel];
+    return nil;
+  }
+  
+  handler = [[ISCacheBackgroundHandler alloc] _initWithSession:self
+                                                          task:task
+                                                     cacheItem:item];
+  if (![item.cache _adoptItem:item
+                      handler:handler]) {
+    [task cancel];
+    return nil;
+  }
+  
+  [item.cache log:@"Reattached background transfer for item %@", item.uid];
+  [self.handlers setObject:handler
+                    forKey:@(task.taskIdentifier)];
+  return handler;
+}
+
+
+- (ISCacheItem *)_itemForTask:(NSURLSessionTask *)task
+{
+  NSData *data = [task.taskDescription dataUsingEncoding:NSUTF8StringEncoding];
+  if ([data length] == 0) {
+    return nil;
+  }
+  
+  NSDictionary *description = [NSJSONSerialization JSONObjectWithData:data
+                                                              options:0
+                                                                error:nil];
+  if (![description isKindOfClass:[NSDictionary class]]) {
+    return nil;
+  }
+  
+  NSString *identifier = [description objectForKey:kDescriptionCacheKey];
+  NSString *uid = [description objectForKey:kDescriptionUidKey];
+  BOOL shared = [[description objectForKey:kDescriptionSharedKey] boolValue];
+  NSString *applicationGroup = [description objectForKey:kDescriptionApplicationGroupKey];
+  if (identifier == nil ||
+      uid == nil) {
+    return nil;
+  }
+  
+  // Open the cache if the application has not yet done so; the
+  // reattached handler keeps it alive until the transfer completes.
+  ISCache *cache = [ISCache _cacheWithIdentifier:identifier];
+  if (cache == nil) {
+    cache = [self.caches objectForKey:identifier];
+  }
+  if (cache == nil) {
+    cache = [[ISCache alloc] initWithIdentifier:identifier
+                                         shared:shared
+                               applicationGroup:applicationGroup];
+    [self.caches setObject:cache
+                    forKey:identifier];
+  }
+  
+  return [cache itemForUid:uid];
+}
+
+
+#pragma mark - NSURLSessionDownloadDelegate
+
+
+- (void)URLSession:(NSURLSession *)session
+      downloadTask:(NSURLSessionDownloadTask *)downloadTask
+      didWriteData:(int64_t)bytesWritten
+ totalBytesWritten:(int64_t)totalBytesWritten
+totalBytesExpectedToWrite:(int64_t)totalBytesExpectedToWrite
+{
+  [[self _handlerForTask:downloadTask] _didWriteData:totalBytesWritten
+                                  totalBytesExpected:totalBytesExpectedToWrite];
+}
+
+
+- (void)URLSession:(NSURLSession *)session
+      downloadTask:(NSURLSessionDownloadTask *)downloadTask
+ didResumeAtOffset:(int64_t)fileOffset
+expectedTotalBytes:(int64_t)expectedTotalBytes
+{
+  [[self _handlerForTask:downloadTask] _didWriteData:fileOffset
+                                  totalBytesExpected:expectedTotalBytes];
+}
+
+
+- (void)URLSession:(NSURLSession *)session
+      downloadTask:(NSURLSessionDownloadTask *)downloadTask
+didFinishDownloadingToURL:(NSURL *)location
+{
+  // The file at location is removed when this method returns so
+  // it must be moved into place synchronously.
+  [[self _handlerForTask:downloadTask] _didFinishDownloadingToURL:location];
+}
+
+
+- (void)URLSession:(NSURLSession *)session
+              task:(NSURLSessionTask *)task
+didCompleteWithError:(NSError *)error
+{
+  // Failed transfers from a previous process are not reattached;
+  // their items are reset during reconciliation.
+  ISCacheBackgroundHandler *handler = [self.handlers objectForKey:@(task.taskIdentifier)];
+  [self removeTask:task];
+  [handler _didCompleteWithError:error];
+}
+
+
+- (void)URLSessionDidFinishEventsForBackgroundURLSession:(NSURLSession *)session
+{
+  if (self.completionHandler) {
+    void (^completionHandler)() = self.completionHandler;
+    self.completionHandler = nil;
+    completionHandler();
+  }
+}
+
+
+@end
@@ -0,0 +1,64 @@
+//
+// Copyright (c) 2013-2014 InSeven Limited.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+typedef enum {
+  
+  // Data is stored exactly as received.
+  ISCacheCompressionNone = 0,
+  // Deflate favouring throughput over ratio.
+  ISCacheCompressionFast = 1,
+  // Deflate favouring ratio over throughput.
+  ISCacheCompressionDefault = 2,
+  
+} ISCacheCompression;
+
+// Incremental zlib compressor or decompressor used to compress cache
+// files as they are written and decompress them as they are read.
+// Decompressors accept concatenated streams, as produced by files which
+// are closed and subsequently appended to.
+@interface ISCacheCodec : NSObject
+
++ (instancetype)compressorWithCompression:(ISCacheCompression)compression;
++ (instancetype)decompressor;
+
+// Decompressor accepting either gzip or zlib streams.
++ (instancetype)gzipDecompressor;
+
+// YES once a decompressor has reached the end of a stream and has not
+// yet begun another.
+@property (nonatomic, readonly) BOOL streamEnded;
+
+// Returns the output produced by the data, which may be empty. Returns
+// nil if the data could not be processed.
+- (NSData *)processData:(NSData *)data;
+
+// Compressors only. Returns the output produced by the data, flushed
+// to a byte boundary so that everything written so far can be read
+// back before the stream is finished.
+- (NSData *)flushData:(NSData *)data;
+
+// Flushes any remaining output; the codec may not be used afterwards.
+- (NSData *)finish;
+
+@end
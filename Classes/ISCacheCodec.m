@@ -0,0 +1,187 @@
+//
+// Copyright (c) 2013-2014 InSeven Limited.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import "ISCacheCodec.h"
+#import <zlib.h>
+
+static const NSUInteger kCodecBufferSize = 16384;
+
+@interface ISCacheCodec () {
+  z_stream _stream;
+}
+
+@property (nonatomic, assign) BOOL compressing;
+@property (nonatomic, assign) BOOL streamEnded;
+
+@end
+
+@implementation ISCacheCodec
+
+
++ (instancetype)compressorWithCompression:(ISCacheCompression)compression
+{
+  int level;
+  if (compression == ISCacheCompressionFast) {
+    level = Z_BEST_SPEED;
+  } else if (compression == ISCacheCompressionDefault) {
+    level = Z_DEFAULT_COMPRESSION;
+  } else {
+    return nil;
+  }
+  return [[self alloc] initCompressorWithLevel:level];
+}
+
+
++ (instancetype)decompressor
+{
+  return [[self alloc] initDecompressorWithWindowBits:MAX_WBITS];
+}
+
+
++ (instancetype)gzipDecompressor
+{
+  // Adding 32 to the window bits enables gzip and zlib header detection.
+  return [[self alloc] initDecompressorWithWindowBits:MAX_WBITS + 32];
+}
+
+
+- (id)initCompressorWithLevel:(int)level
+{
+  self = [super init];
+  if (self) {
+    memset(&_stream, 0, sizeof(_stream));
+    if (deflateInit(&_stream, level) != Z_OK) {
+      return nil;
+    }
+    self.compressing = YES;
+  }
+  return self;
+}
+
+
+- (id)initDecompressorWithWindowBits:(int)windowBits
+{
+  self = [super init];
+  if (self) {
+    memset(&_stream, 0, sizeof(_stream));
+    if (inflateInit2(&_stream, windowBits) != Z_OK) {
+      return nil;
+    }
+    self.compressing = NO;
+  }
+  return self;
+}
+
+
+- (void)dealloc
+{
+  if (self.compressing) {
+    deflateEnd(&_stream);
+  } else {
+    inflateEnd(&_stream);
+  }
+}
+
+
+- (NSData *)processData:(NSData *)data
+{
+  if (self.compressing) {
+    return [self _deflate:data
+                    flush:Z_NO_FLUSH];
+  } else {
+    return [self _inflate:data];
+  }
+}
+
+
+- (NSData *)flushData:(NSData *)data
+{
+  assert(self.compressing);
+  return [self _deflate:data
+                  flush:Z_SYNC_FLUSH];
+}
+
+
+- (NSData *)finish
+{
+  if (self.compressing) {
+    return [self _deflate:nil
+                    flush:Z_FINISH];
+  }
+  return [NSData data];
+}
+
+
+#pragma mark - Utilities
+
+
+- (NSData *)_deflate:(NSData *)data
+               flush:(int)flush
+{
+  NSMutableData *output = [NSMutableData data];
+  uint8_t buffer[kCodecBufferSize];
+  _stream.next_in = (Bytef *)[data bytes];
+  _stream.avail_in = (uInt)[data length];
+  do {
+    _stream.next_out = buffer;
+    _stream.avail_out = kCodecBufferSize;
+    if (deflate(&_stream, flush) == Z_STREAM_ERROR) {
+      return nil;
+    }
+    [output appendBytes:buffer
+                 length:kCodecBufferSize - _stream.avail_out];
+  } while (_stream.avail_out == 0);
+  return output;
+}
+
+
+- (NSData *)_inflate:(NSData *)data
+{
+  NSMutableData *output = [NSMutableData data];
+  uint8_t buffer[kCodecBufferSize];
+  _stream.next_in = (Bytef *)[data bytes];
+  _stream.avail_in = (uInt)[data length];
+  do {
+    
+    // Begin the next stream if one follows the previous.
+    if (self.streamEnded && _stream.avail_in > 0) {
+      inflateReset(&_stream);
+      self.streamEnded = NO;
+    }
+    
+    _stream.next_out = buffer;
+    _stream.avail_out = kCodecBufferSize;
+    int status = inflate(&_stream, Z_NO_FLUSH);
+    if (status == Z_STREAM_END) {
+      self.streamEnded = YES;
+    } else if (status != Z_OK && status != Z_BUF_ERROR) {
+      return nil;
+    }
+    [output appendBytes:buffer
+                 length:kCodecBufferSize - _stream.avail_out];
+    
+  } while (_stream.avail_out == 0 || _stream.avail_in > 0);
+  return output;
+}
+
+
+@end
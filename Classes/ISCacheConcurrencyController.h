@@ -0,0 +1,64 @@
+//
+// Copyright (c) 2013-2014 InSeven Limited.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+@class ISCacheItem;
+
+// Adjusts the number of concurrent fetches based on observed throughput
+// and latency using additive-increase/multiplicative-decrease: the limit
+// grows by one while throughput keeps improving and halves when
+// throughput falls or latency rises sharply.
+//
+// Measurements are taken over windows of completed fetches, where each
+// window contains as many fetches as the current limit.
+@interface ISCacheConcurrencyController : NSObject
+
+@property (nonatomic, readonly) NSUInteger limit;
+@property (nonatomic) NSUInteger minimumLimit;
+@property (nonatomic) NSUInteger maximumLimit;
+
+// Aggregate throughput in bytes per second for the last window.
+@property (nonatomic, readonly) double throughput;
+
+// Average duration of the fetches in the last window and the latency
+// baseline. The baseline follows the lowest window average but drifts
+// towards higher averages, so sustained changes in latency (e.g. larger
+// responses) become the new normal rather than pinning the limit.
+@property (nonatomic, readonly) NSTimeInterval averageLatency;
+@property (nonatomic, readonly) NSTimeInterval baselineLatency;
+
+// Returns the current time; defaults to the system clock.
+@property (nonatomic, copy) NSDate *(^clock)(void);
+
+- (id)initWithLimit:(NSUInteger)limit
+       minimumLimit:(NSUInteger)minimumLimit
+       maximumLimit:(NSUInteger)maximumLimit;
+
+- (void)fetchDidStart:(ISCacheItem *)item;
+
+// Returns YES if the limit changed as a result of the fetch finishing.
+- (BOOL)fetchDidFinish:(ISCacheItem *)item;
+- (void)fetchDidFail:(ISCacheItem *)item;
+- (void)fetchDidCancel:(ISCacheItem *)item;
+
+@end
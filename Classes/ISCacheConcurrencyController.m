@@ -0,0 +1,175 @@
+//
+// Copyright (c) 2013-2014 InSeven Limited.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import "ISCacheConcurrencyController.h"
+#import "ISCacheItem.h"
+
+// Throughput must remain within this fraction of the previous window
+// for the limit to increase, and drop below the decrease fraction for
+// it to be halved.
+static const double kIncreaseThreshold = 0.95;
+static const double kDecreaseThreshold = 0.75;
+
+// Latency may rise to this multiple of the baseline before the limit
+// is halved regardless of throughput. Increases smaller than the
+// minimum are ignored to avoid reacting to noise on fast fetches.
+static const double kLatencyThreshold = 2.0;
+static const NSTimeInterval kMinimumLatencyIncrease = 0.25;
+
+// Fraction of the difference by which the baseline moves towards a
+// window average above it.
+static const double kBaselineDrift = 0.25;
+
+@interface ISCacheConcurrencyController ()
+
+@property (nonatomic, assign) NSUInteger limit;
+@property (nonatomic, assign) double throughput;
+@property (nonatomic, assign) NSTimeInterval averageLatency;
+@property (nonatomic, assign) NSTimeInterval baselineLatency;
+
+@property (nonatomic, strong) NSMutableDictionary *started;
+@property (nonatomic, strong) NSDate *windowStart;
+@property (nonatomic, assign) NSUInteger windowCount;
+@property (nonatomic, assign) long long windowBytes;
+@property (nonatomic, assign) NSTimeInterval windowLatency;
+
+@end
+
+@implementation ISCacheConcurrencyController
+
+
+- (id)initWithLimit:(NSUInteger)limit
+       minimumLimit:(NSUInteger)minimumLimit
+       maximumLimit:(NSUInteger)maximumLimit
+{
+  self = [super init];
+  if (self) {
+    assert(minimumLimit > 0);
+    assert(minimumLimit <= maximumLimit);
+    self.minimumLimit = minimumLimit;
+    self.maximumLimit = maximumLimit;
+    self.limit = MIN(MAX(limit, minimumLimit), maximumLimit);
+    self.started = [NSMutableDictionary dictionaryWithCapacity:maximumLimit];
+    self.clock = ^{
+      return [NSDate date];
+    };
+  }
+  return self;
+}
+
+
+- (void)fetchDidStart:(ISCacheItem *)item
+{
+  assert([NSThread isMainThread]);
+  [self.started setObject:self.clock()
+                   forKey:item.uid];
+}
+
+
+- (BOOL)fetchDidFinish:(ISCacheItem *)item
+{
+  assert([NSThread isMainThread]);
+  NSDate *start = [self.started objectForKey:item.uid];
+  if (start == nil) {
+    return NO;
+  }
+  [self.started removeObjectForKey:item.uid];
+  
+  // Windows span the fetches completed within them, starting from the
+  // earliest of those fetches rather than from when the previous window
+  // completed, as fetches still in flight at that point have already
+  // received some of their bytes.
+  if (self.windowStart == nil ||
+      [start compare:self.windowStart] == NSOrderedAscending) {
+    self.windowStart = start;
+  }
+  self.windowCount++;
+  self.windowBytes += item.totalBytesRead;
+  self.windowLatency += [self.clock() timeIntervalSinceDate:start];
+  
+  if (self.windowCount < self.limit) {
+    return NO;
+  }
+  
+  return [self _completeWindow];
+}
+
+
+- (void)fetchDidFail:(ISCacheItem *)item
+{
+  assert([NSThread isMainThread]);
+  [self.started removeObjectForKey:item.uid];
+}
+
+
+- (void)fetchDidCancel:(ISCacheItem *)item
+{
+  assert([NSThread isMainThread]);
+  [self.started removeObjectForKey:item.uid];
+}
+
+
+#pragma mark - Utilities
+
+
+- (BOOL)_completeWindow
+{
+  NSTimeInterval duration = [self.clock() timeIntervalSinceDate:self.windowStart];
+  double throughput = duration > 0 ? self.windowBytes / duration : 0;
+  NSTimeInterval latency = self.windowLatency / self.windowCount;
+  double previousThroughput = self.throughput;
+  
+  self.throughput = throughput;
+  self.averageLatency = latency;
+  NSTimeInterval baseline = self.baselineLatency > 0 ? self.baselineLatency : latency;
+  if (latency < baseline) {
+    self.baselineLatency = latency;
+  } else {
+    self.baselineLatency = baseline + (latency - baseline) * kBaselineDrift;
+  }
+  
+  // Start the next window.
+  self.windowStart = nil;
+  self.windowCount = 0;
+  self.windowBytes = 0;
+  self.windowLatency = 0;
+  
+  NSUInteger limit = self.limit;
+  BOOL latencyIncreased =
+  (latency > baseline * kLatencyThreshold &&
+   latency - baseline > kMinimumLatencyIncrease);
+  if (latencyIncreased ||
+      throughput < previousThroughput * kDecreaseThreshold) {
+    limit = MAX(self.minimumLimit, limit / 2);
+  } else if (throughput >= previousThroughput * kIncreaseThreshold) {
+    limit = MIN(self.maximumLimit, limit + 1);
+  }
+  
+  if (limit == self.limit) {
+    return NO;
+  }
+  self.limit = limit;
+  return YES;
+}
+
+
+@end
@@ -0,0 +1,122 @@
+//
+// Copyright (c) 2013-2014 InSeven Limited.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import "ISCacheDecryptTransform.h"
+#import "ISCache.h"
+#import <CommonCrypto/CommonCryptor.h>
+
+@interface ISCacheDecryptTransform ()
+
+@property (nonatomic, assign) CCCryptorRef cryptor;
+
+@end
+
+@implementation ISCacheDecryptTransform
+
+
+- (id)initWithKey:(NSData *)key
+               iv:(NSData *)iv
+{
+  self = [super init];
+  if (self) {
+    assert([iv length] == kCCBlockSizeAES128);
+    CCCryptorRef cryptor = NULL;
+    CCCryptorStatus status =
+    CCCryptorCreate(kCCDecrypt,
+                    kCCAlgorithmAES128,
+                    kCCOptionPKCS7Padding,
+                    [key bytes],
+                    [key length],
+                    [iv bytes],
+                    &cryptor);
+    if (status != kCCSuccess) {
+      return nil;
+    }
+    self.cryptor = cryptor;
+  }
+  return self;
+}
+
+
+- (void)dealloc
+{
+  if (self.cryptor) {
+    CCCryptorRelease(self.cryptor);
+  }
+}
+
+
+- (NSData *)transformData:(NSData *)data
+                    error:(NSError **)error
+{
+  size_t length = CCCryptorGetOutputLength(self.cryptor, [data length], false);
+  NSMutableData *output = [NSMutableData dataWithLength:length];
+  size_t moved = 0;
+  CCCryptorStatus status =
+  CCCryptorUpdate(self.cryptor,
+                  [data bytes],
+                  [data length],
+                  [output mutableBytes],
+                  length,
+                  &moved);
+  if (status != kCCSuccess) {
+    [self _setError:error status:status];
+    return nil;
+  }
+  [output setLength:moved];
+  return output;
+}
+
+
+- (NSData *)finishWithError:(NSError **)error
+{
+  size_t length = CCCryptorGetOutputLength(self.cryptor, 0, true);
+  NSMutableData *output = [NSMutableData dataWithLength:length];
+  size_t moved = 0;
+  CCCryptorStatus status =
+  CCCryptorFinal(self.cryptor,
+                 [output mutableBytes],
+                 length,
+                 &moved);
+  if (status != kCCSuccess) {
+    [self _setError:error status:status];
+    return nil;
+  }
+  [output setLength:moved];
+  return output;
+}
+
+
+- (void)_setError:(NSError **)error
+           status:(CCCryptorStatus)status
+{
+  if (error) {
+    *error = [NSError errorWithDomain:ISCacheErrorDomain
+                                 code:ISCacheErrorTransformFailed
+                             userInfo:@{NSUnderlyingErrorKey: [NSError errorWithDomain:NSOSStatusErrorDomain
+                                                                                  code:status
+                                                                              userInfo:nil]}];
+  }
+}
+
+
+@end
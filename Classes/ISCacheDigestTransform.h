@@ -0,0 +1,47 @@
+//
+// Copyright (c) 2013-2014 InSeven Limited.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+#import "ISCacheTransform.h"
+
+typedef enum {
+  ISCacheDigestAlgorithmMD5,
+  ISCacheDigestAlgorithmSHA1,
+  ISCacheDigestAlgorithmSHA256,
+} ISCacheDigestAlgorithm;
+
+// Computes a digest of the data passing through it without modifying
+// the data. If an expected digest is provided, finishing fails with
+// ISCacheErrorVerificationFailed when the digests differ.
+@interface ISCacheDigestTransform : NSObject <ISCacheTransform>
+
+@property (nonatomic, readonly) ISCacheDigestAlgorithm algorithm;
+@property (nonatomic, readonly) NSData *expectedDigest;
+
+// Available once the transform has finished.
+@property (nonatomic, readonly) NSData *digest;
+
+- (id)initWithAlgorithm:(ISCacheDigestAlgorithm)algorithm;
+- (id)initWithAlgorithm:(ISCacheDigestAlgorithm)algorithm
+         expectedDigest:(NSData *)expectedDigest;
+
+@end
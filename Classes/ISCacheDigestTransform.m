@@ -0,0 +1,110 @@
+//
+// Copyright (c) 2013-2014 InSeven Limited.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import "ISCacheDigestTransform.h"
+#import "ISCache.h"
+#import <CommonCrypto/CommonDigest.h>
+
+@interface ISCacheDigestTransform () {
+  CC_MD5_CTX _md5;
+  CC_SHA1_CTX _sha1;
+  CC_SHA256_CTX _sha256;
+}
+
+@property (nonatomic, assign) ISCacheDigestAlgorithm algorithm;
+@property (nonatomic, strong) NSData *expectedDigest;
+@property (nonatomic, strong) NSData *digest;
+
+@end
+
+@implementation ISCacheDigestTransform
+
+
+- (id)initWithAlgorithm:(ISCacheDigestAlgorithm)algorithm
+{
+  return [self initWithAlgorithm:algorithm
+                  expectedDigest:nil];
+}
+
+
+- (id)initWithAlgorithm:(ISCacheDigestAlgorithm)algorithm
+         expectedDigest:(NSData *)expectedDigest
+{
+  self = [super init];
+  if (self) {
+    self.algorithm = algorithm;
+    self.expectedDigest = expectedDigest;
+    if (algorithm == ISCacheDigestAlgorithmMD5) {
+      CC_MD5_Init(&_md5);
+    } else if (algorithm == ISCacheDigestAlgorithmSHA1) {
+      CC_SHA1_Init(&_sha1);
+    } else {
+      CC_SHA256_Init(&_sha256);
+    }
+  }
+  return self;
+}
+
+
+- (NSData *)transformData:(NSData *)data
+                    error:(NSError **)error
+{
+  if (self.algorithm == ISCacheDigestAlgorithmMD5) {
+    CC_MD5_Update(&_md5, [data bytes], (CC_LONG)[data length]);
+  } else if (self.algorithm == ISCacheDigestAlgorithmSHA1) {
+    CC_SHA1_Update(&_sha1, [data bytes], (CC_LONG)[data length]);
+  } else {
+    CC_SHA256_Update(&_sha256, [data bytes], (CC_LONG)[data length]);
+  }
+  return data;
+}
+
+
+- (NSData *)finishWithError:(NSError **)error
+{
+  NSMutableData *digest;
+  if (self.algorithm == ISCacheDigestAlgorithmMD5) {
+    digest = [NSMutableData dataWithLength:CC_MD5_DIGEST_LENGTH];
+    CC_MD5_Final([digest mutableBytes], &_md5);
+  } else if (self.algorithm == ISCacheDigestAlgorithmSHA1) {
+    digest = [NSMutableData dataWithLength:CC_SHA1_DIGEST_LENGTH];
+    CC_SHA1_Final([digest mutableBytes], &_sha1);
+  } else {
+    digest = [NSMutableData dataWithLength:CC_SHA256_DIGEST_LENGTH];
+    CC_SHA256_Final([digest mutableBytes], &_sha256);
+  }
+  self.digest = digest;
+  
+  if (self.expectedDigest &&
+      ![self.expectedDigest isEqualToData:self.digest]) {
+    if (error) {
+      *error = [NSError errorWithDomain:ISCacheErrorDomain
+                                   code:ISCacheErrorVerificationFailed
+                               userInfo:nil];
+    }
+    return nil;
+  }
+  return [NSData data];
+}
+
+
+@end
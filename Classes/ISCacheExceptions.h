@@ -32,6 +32,7 @@ extern NSString *const ISCacheExceptionUnsupportedCacheStoreItemVersion;
 extern NSString *const ISCacheExceptionInvalidHandler;
 extern NSString *const ISCacheExceptionInvalidUserInfo;
 extern NSString *const ISCacheExceptionUnsupportedState;
+extern NSString *const ISCacheExceptionReadOnlyFile;
 
 // Reason.
 extern NSString *const ISCacheExceptionUnableToCreateItemDirectoryReason;
@@ -42,4 +43,5 @@ extern NSString *const ISCacheExceptionUnsupportedCacheStoreVersionReason;
 extern NSString *const ISCacheExceptionUnsupportedCacheStoreItemVersionReason;
 extern NSString *const ISCacheExceptionInvalidHandlerReason;
 extern NSString *const ISCacheExceptionInvalidUserInfoReason;
-extern NSString *const ISCacheExceptionUnsupportedStateReason;
\ No newline at end of file
+extern NSString *const ISCacheExceptionUnsupportedStateReason;
+extern NSString *const ISCacheExceptionReadOnlyFileReason;
\ No newline at end of file
@@ -32,6 +32,7 @@ NSString *const ISCacheExceptionUnsupportedCacheStoreItemVersion =  @"ISCacheExc
 NSString *const ISCacheExceptionInvalidHandler = @"ISCacheExceptionInvalidHandler";
 NSString *const ISCacheExceptionInvalidUserInfo = @"ISCacheExceptionInvalidUserInfo";
 NSString *const ISCacheExceptionUnsupportedState = @"ISCacheExceptionUnsupportedState";
+NSString *const ISCacheExceptionReadOnlyFile = @"ISCacheExceptionReadOnlyFile";
 
 // Reason.
 NSString *const ISCacheExceptionUnableToCreateItemDirectoryReason = @"It was not possible to create the directory for the cache items.";
@@ -43,3 +44,4 @@ NSString *const ISCacheExceptionUnsupportedCacheStoreItemVersionReason =  @"Unab
 NSString *const ISCacheExceptionInvalidHandlerReason = @"Cache handlers must respond to the NSCacheHandler protocol.";
 NSString *const ISCacheExceptionInvalidUserInfoReason = @"User info must contain data which can be serialized.";
 NSString *const ISCacheExceptionUnsupportedStateReason = @"The ISCacheItemState is unsupported.";
+NSString *const ISCacheExceptionReadOnlyFileReason = @"Files served from a pack cannot be modified.";
@@ -22,22 +22,47 @@
 
 #import <Foundation/Foundation.h>
 #import "UIImage+Utilities.h"
+#import "ISCacheCodec.h"
 
 typedef enum {
   ISCacheFileStateClosed,
   ISCacheFileStateOpen,
 } ISCacheFileState;
 
+@class ISCacheFile;
+
+@protocol ISCacheFileDelegate <NSObject>
+
+- (void)cacheFileDidAppendData:(ISCacheFile *)file;
+
+@end
+
 @interface ISCacheFile : NSObject
 
 @property (nonatomic, readonly) NSString *path;
 @property (nonatomic, strong) NSString *filename;
+@property (nonatomic, weak) id<ISCacheFileDelegate> delegate;
+
+// Compression applied to data as it is written. Files are
+// decompressed transparently by -data; -path and -handle refer
+// to the stored representation.
+@property (nonatomic, readonly) ISCacheCompression compression;
+
+// Number of bytes written to the file so far (before compression)
+// and the number of bytes occupied on disk.
+@property (readonly) unsigned long long length;
+@property (readonly) unsigned long long storedLength;
 
 - (id)initWithDirectory:(NSString *)directory
                filename:(NSString *)filename;
+- (id)initWithDirectory:(NSString *)directory
+               filename:(NSString *)filename
+            compression:(ISCacheCompression)compression
+                 length:(unsigned long long)length;
 - (void)open;
 - (void)close;
 - (void)appendData:(NSData *)data;
+- (void)writeData:(NSData *)data;
 - (NSData *)data;
 - (void)remove;
 - (BOOL)exists;
@@ -27,6 +27,9 @@
 @property (nonatomic, strong) NSFileHandle *fileHandle;
 @property (nonatomic, strong) NSString *directory;
 @property ISCacheFileState fileState;
+@property unsigned long long writtenLength;
+@property unsigned long long storedWrittenLength;
+@property (nonatomic, strong) ISCacheCodec *compressor;
 
 @end
 
@@ -35,11 +38,25 @@
 
 - (id)initWithDirectory:(NSString *)directory
                filename:(NSString *)filename
+{
+  return [self initWithDirectory:directory
+                        filename:filename
+                     compression:ISCacheCompressionNone
+                          length:0];
+}
+
+
+- (id)initWithDirectory:(NSString *)directory
+               filename:(NSString *)filename
+            compression:(ISCacheCompression)compression
+                 length:(unsigned long long)length
 {
   self = [super init];
   if (self) {
     self.directory = directory;
     self.filename = filename;
+    _compression = compression;
+    self.writtenLength = length;
   }
   return self;
 }
@@ -75,7 +92,16 @@
       = [NSFileHandle fileHandleForWritingAtPath:self.path];
     }
     
-    [self.fileHandle seekToEndOfFile];
+    self.storedWrittenLength = [self.fileHandle seekToEndOfFile];
+    
+    // Compressed files are appended to as a new compressed stream
+    // so the logical length is carried over from previous writes.
+    if (self.compression == ISCacheCompressionNone) {
+      self.writtenLength = self.storedWrittenLength;
+    } else {
+      self.compressor = [ISCacheCodec compressorWithCompression:self.compression];
+    }
+    
     self.fileState = ISCacheFileStateOpen;
   }
 }
@@ -84,6 +110,10 @@
 - (void)close
 {
   if (self.fileState == ISCacheFileStateOpen) {
+    if (self.compressor) {
+      [self _writeStoredData:[self.compressor finish]];
+      self.compressor = nil;
+    }
     [self.fileHandle closeFile];
     self.fileState = ISCacheFileStateClosed;
   }
@@ -93,20 +123,64 @@
 - (void)appendData:(NSData *)data
 {
   [self open];
-  [self.fileHandle writeData:data];
+  
+  // Compressed output is flushed with each append so that streaming
+  // readers receive data as it arrives rather than at close.
+  if (self.compressor) {
+    [self _writeStoredData:[self.compressor flushData:data]];
+  } else {
+    [self _writeStoredData:data];
+  }
+  self.writtenLength += [data length];
+  [self.delegate cacheFileDidAppendData:self];
 }
 
 
-- (NSData *)data
+// Replaces the contents of the file.
+- (void)writeData:(NSData *)data
 {
+  [self remove];
+  [self appendData:data];
   [self close];
-  return [NSData dataWithContentsOfFile:self.path];
+}
+
+
+- (unsigned long long)length
+{
+  if (self.fileState == ISCacheFileStateOpen ||
+      self.compression != ISCacheCompressionNone) {
+    return self.writtenLength;
+  }
+  return [self _fileSize];
+}
+
+
+- (unsigned long long)storedLength
+{
+  if (self.fileState == ISCacheFileStateOpen) {
+    return self.storedWrittenLength;
+  }
+  return [self _fileSize];
+}
+
+
+// Files which are still being written are left open; the data
+// flushed so far is returned.
+- (NSData *)data
+{
+  NSData *data = [NSData dataWithContentsOfFile:self.path];
+  if (data == nil ||
+      self.compression == ISCacheCompressionNone) {
+    return data;
+  }
+  return [[ISCacheCodec decompressor] processData:data];
 }
 
 
 - (void)remove
 {
   [self close];
+  self.writtenLength = 0;
   NSError *error;
   NSFileManager *fileManager = [NSFileManager defaultManager];
   [fileManager removeItemAtPath:self.path
@@ -138,4 +212,26 @@
 }
 
 
+#pragma mark - Utilities
+
+
+- (void)_writeStoredData:(NSData *)data
+{
+  if ([data length] == 0) {
+    return;
+  }
+  [self.fileHandle writeData:data];
+  self.storedWrittenLength += [data length];
+}
+
+
+- (unsigned long long)_fileSize
+{
+  NSFileManager *fileManager = [NSFileManager defaultManager];
+  NSDictionary *attributes = [fileManager attributesOfItemAtPath:self.path
+                                                           error:nil];
+  return [attributes fileSize];
+}
+
+
 @end
@@ -0,0 +1,41 @@
+//
+// Copyright (c) 2013-2014 InSeven Limited.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+#import "ISCacheAdmissionPolicy.h"
+
+// TinyLFU admission: approximate request frequencies are kept in a
+// count-min sketch of 4-bit counters which are halved periodically so
+// that old popularity decays. An item is only admitted if it has been
+// requested more often than the item it would evict, so one-off
+// requests cannot flush frequently used items.
+@interface ISCacheFrequencyAdmissionPolicy : NSObject <ISCacheAdmissionPolicy>
+
+// The capacity is the approximate number of items the cache is
+// expected to hold, and determines the size of the sketch.
++ (instancetype)policyWithCapacity:(NSUInteger)capacity;
+- (id)initWithCapacity:(NSUInteger)capacity;
+
+// Estimated number of recent requests for the uid.
+- (NSUInteger)frequencyForUid:(NSString *)uid;
+
+@end
@@ -0,0 +1,143 @@
+//
+// Copyright (c) 2013-2014 InSeven Limited.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import "ISCacheFrequencyAdmissionPolicy.h"
+#import "ISCacheItem.h"
+
+// Number of rows in the sketch, each indexed by an independent hash.
+static const NSUInteger kSketchDepth = 4;
+static const NSUInteger kMinimumWidth = 16;
+static const uint8_t kMaximumCount = 15;
+
+// Counters are halved once this many requests per unit of capacity
+// have been recorded.
+static const NSUInteger kSampleFactor = 10;
+
+static const uint32_t kSketchSeeds[kSketchDepth] = {
+  0x9e3779b9, 0x85ebca6b, 0xc2b2ae35, 0x27d4eb2f
+};
+
+// FNV-1a, perturbed by the seed.
+static uint32_t ISCacheSketchHash(NSString *uid, uint32_t seed)
+{
+  uint32_t hash = 2166136261u ^ seed;
+  for (const char *bytes = [uid UTF8String]; *bytes; bytes++) {
+    hash ^= (uint8_t)*bytes;
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+@interface ISCacheFrequencyAdmissionPolicy ()
+
+@property (nonatomic, strong) NSMutableData *counters;
+@property (nonatomic, assign) NSUInteger width;
+@property (nonatomic, assign) NSUInteger additions;
+@property (nonatomic, assign) NSUInteger sampleSize;
+
+@end
+
+@implementation ISCacheFrequencyAdmissionPolicy
+
+
++ (instancetype)policyWithCapacity:(NSUInteger)capacity
+{
+  return [[self alloc] initWithCapacity:capacity];
+}
+
+
+- (id)initWithCapacity:(NSUInteger)capacity
+{
+  self = [super init];
+  if (self) {
+    
+    // Widths are a power of two so that hashes can be masked.
+    NSUInteger width = kMinimumWidth;
+    while (width < capacity) {
+      width <<= 1;
+    }
+    self.width = width;
+    self.counters = [NSMutableData dataWithLength:width * kSketchDepth];
+    self.sampleSize = MAX(capacity, kMinimumWidth) * kSampleFactor;
+    
+  }
+  return self;
+}
+
+
+- (NSUInteger)frequencyForUid:(NSString *)uid
+{
+  const uint8_t *counters = [self.counters bytes];
+  uint8_t frequency = kMaximumCount;
+  for (NSUInteger row = 0; row < kSketchDepth; row++) {
+    NSUInteger index = row * self.width + (ISCacheSketchHash(uid, kSketchSeeds[row]) & (self.width - 1));
+    frequency = MIN(frequency, counters[index]);
+  }
+  return frequency;
+}
+
+
+- (void)_incrementUid:(NSString *)uid
+{
+  uint8_t *counters = [self.counters mutableBytes];
+  for (NSUInteger row = 0; row < kSketchDepth; row++) {
+    NSUInteger index = row * self.width + (ISCacheSketchHash(uid, kSketchSeeds[row]) & (self.width - 1));
+    if (counters[index] < kMaximumCount) {
+      counters[index]++;
+    }
+  }
+  
+  // Age the sketch so that items which are no longer requested lose
+  // their advantage.
+  self.additions++;
+  if (self.additions >= self.sampleSize) {
+    NSUInteger length = [self.counters length];
+    for (NSUInteger i = 0; i < length; i++) {
+      counters[i] >>= 1;
+    }
+    self.additions /= 2;
+  }
+}
+
+
+#pragma mark - ISCacheAdmissionPolicy
+
+
+- (void)recordAccessForItem:(ISCacheItem *)item
+{
+  assert([NSThread isMainThread]);
+  [self _incrementUid:item.uid];
+}
+
+
+- (BOOL)shouldAdmitItem:(ISCacheItem *)item
+                 victim:(ISCacheItem *)victim
+{
+  assert([NSThread isMainThread]);
+  if (victim == nil) {
+    return YES;
+  }
+  return [self frequencyForUid:item.uid] > [self frequencyForUid:victim.uid];
+}
+
+
+@end
@@ -22,8 +22,10 @@
 
 #import <Foundation/Foundation.h>
 #import "ISCacheHandler.h"
+#import "ISCacheTransform.h"
 
 typedef NSError *(^ISCachePostProcessBlock)(ISCacheItem *info);
+typedef unsigned long long (^ISCachePostProcessCostBlock)(ISCacheItem *info);
 
 @interface ISCacheHTTPHandler : NSObject
 <ISCacheHandler
@@ -33,4 +35,22 @@ typedef NSError *(^ISCachePostProcessBlock)(ISCacheItem *info);
 - (id)init;
 - (id)initWithCompletion:(ISCachePostProcessBlock)completionBlock;
 
+// Received data is passed through the transform before it is written,
+// so the file holds the data in its final form. Use a transform chain
+// to apply multiple stages, and ISCacheTransformHandlerFactory to
+// register handlers with transforms for a context.
+- (id)initWithTransform:(id<ISCacheTransform>)transform
+             completion:(ISCachePostProcessBlock)completionBlock;
+
+// Name of the file the response is written to, taken from the
+// response's suggested filename once the response is received.
+@property (nonatomic, readonly) NSString *filename;
+
+// Returns the cost of post-processing the item, charged against the
+// processing queue's cost budget. Called on the main thread once the
+// download is complete. If nil, the number of bytes downloaded is
+// used, which underestimates the memory needed to decode compressed
+// formats such as images.
+@property (nonatomic, copy) ISCachePostProcessCostBlock costBlock;
+
 @end
@@ -22,8 +22,14 @@
 
 #import "ISCacheHTTPHandler.h"
 #import "ISCache.h"
+#import "ISCacheProcessingQueue.h"
 #import <ISUtilities/UIApplication+Activity.h>
 
+// Interrupted downloads which support resume are restarted a limited
+// number of times, backing off between attempts.
+static const NSInteger kMaximumRequests = 3;
+static const NSTimeInterval kRestartDelay = 1.0;
+
 @interface ISCacheHTTPHandler ()
 
 @property (nonatomic, weak) id<ISCacheHandlerUpdater> updater;
@@ -31,6 +37,7 @@
 @property (nonatomic, strong) NSURLConnection *connection;
 @property (nonatomic, strong) NSString *filename;
 @property (nonatomic, copy) ISCachePostProcessBlock completionBlock;
+@property (nonatomic, strong) id<ISCacheTransform> transform;
 @property (nonatomic) BOOL supportsResume;
 @property (nonatomic) NSInteger requestCount;
 @property (nonatomic) int statusCode;
@@ -46,9 +53,17 @@
 }
 
 - (id)initWithCompletion:(ISCachePostProcessBlock)completionBlock
+{
+  return [self initWithTransform:nil
+                      completion:completionBlock];
+}
+
+- (id)initWithTransform:(id<ISCacheTransform>)transform
+             completion:(ISCachePostProcessBlock)completionBlock
 {
   self = [super init];
   if (self) {
+    self.transform = transform;
     self.completionBlock = completionBlock;
     self.requestCount = 0;
   }
@@ -113,15 +128,18 @@ didReceiveResponse:(NSURLResponse *)response
   }
   
   // Check for error responses.
-  // TODO What other errors do I need to check for.
-  self.statusCode = (int)[((NSHTTPURLResponse *)response) statusCode];
-  if (self.statusCode == 404)
-  {
-    [connection cancel];
-    [self.updater item:self.cacheItem
-       didFailWithError:[NSError errorWithDomain:@"s" code:0 userInfo:nil]];
-    [self.updater log:@"didReceiveResponse statusCode with %i", self.statusCode];
-    return;
+  if ([response isKindOfClass:[NSHTTPURLResponse class]]) {
+    self.statusCode = (int)[((NSHTTPURLResponse *)response) statusCode];
+    if (self.statusCode >= 400) {
+      [connection cancel];
+      [[UIApplication sharedApplication] endNetworkActivity];
+      [self.updater log:@"didReceiveResponse statusCode with %i", self.statusCode];
+      [self.updater item:self.cacheItem
+         didFailWithError:[NSError errorWithDomain:ISCacheErrorDomain
+                                              code:ISCacheErrorHTTPStatus
+                                          userInfo:@{ISCacheErrorStatusCodeKey: @(self.statusCode)}]];
+      return;
+    }
   }
   
   // If the request count is greater than 1 we are attempting a resume
@@ -152,6 +170,19 @@ didReceiveResponse:(NSURLResponse *)response
   
   [self.updater log:@"connection:didReceiveData:"];
   self.cacheItem.totalBytesRead += [data length];
+  
+  if (self.transform) {
+    NSError *error;
+    data = [self.transform transformData:data
+                                   error:&error];
+    if (data == nil) {
+      [connection cancel];
+      [[UIApplication sharedApplication] endNetworkActivity];
+      [self failWithError:error];
+      return;
+    }
+  }
+  
   [[self.cacheItem file:self.filename] appendData:data];
 }
 
@@ -165,19 +196,38 @@ didReceiveResponse:(NSURLResponse *)response
   [[UIApplication sharedApplication] endNetworkActivity];
   if(self.cacheItem.totalBytesRead !=
      self.cacheItem.totalBytesExpectedToRead) {
-    [self restartOrFailWithError:[NSError errorWithDomain:@"s" code:0 userInfo:nil]];
+    [self restartOrFailWithError:[NSError errorWithDomain:ISCacheErrorDomain
+                                                     code:ISCacheErrorIncomplete
+                                                 userInfo:nil]];
     return;
   }
   
+  if (self.transform) {
+    NSError *error;
+    NSData *data = [self.transform finishWithError:&error];
+    if (data == nil) {
+      [self failWithError:error];
+      return;
+    }
+    [[self.cacheItem file:self.filename] appendData:data];
+  }
+  
   [[self.cacheItem file:self.filename] close];
   
   // Schedule the post-processing if neccessary.
   // Otherwise, simply call the final block.
   if (self.completionBlock) {
     
-    dispatch_queue_t queue =
-    dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_BACKGROUND, 0);
-    dispatch_async(queue, ^{
+    // Post-processing is bounded by the shared processing queue to
+    // avoid decoding large numbers of files at once. The downloaded
+    // size is used as an estimate of the memory cost of the job unless
+    // the post-processor provides its own.
+    unsigned long long cost =
+      self.costBlock
+      ? self.costBlock(self.cacheItem)
+      : self.cacheItem.totalBytesRead;
+    ISCacheProcessingQueue *queue = [ISCacheProcessingQueue defaultQueue];
+    [queue addJob:^{
       NSError *error = self.completionBlock(self.cacheItem);
       
       // Signal that the resizing is complete.
@@ -196,7 +246,7 @@ didReceiveResponse:(NSURLResponse *)response
         }
       });
       
-    });
+    } cost:cost];
   } else {
     [self.updater itemDidFinish:self.cacheItem];
   }
@@ -221,15 +271,30 @@ didReceiveResponse:(NSURLResponse *)response
     return;
   }
   
-  [self.updater log:@"Restarting download..."];
-  if (self.supportsResume) {
-    [self start];
+  if (self.supportsResume &&
+      self.requestCount < kMaximumRequests) {
+    [self.updater log:@"Restarting download..."];
+    NSTimeInterval delay = kRestartDelay * pow(2.0, self.requestCount - 1);
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+      if (self.cancelled) {
+        return;
+      }
+      [self start];
+    });
   } else {
     [self.updater item:self.cacheItem
        didFailWithError:error];
   }
 }
 
+// Transform failures cannot be recovered by restarting as the
+// transform has already consumed the data.
+- (void)failWithError:(NSError *)error
+{
+  [self.updater item:self.cacheItem
+    didFailWithError:error];
+}
+
 - (BOOL)supportsBackgroundFetch
 {
   return YES;
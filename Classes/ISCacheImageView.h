@@ -35,6 +35,12 @@ typedef void (^ISCacheCompletionBlock)(NSError *error);
                             preferences:(NSDictionary *)preferences
                        placeholderImage:(UIImage *)placeholderImage
                                   block:(ISCacheCompletionBlock)block;
+- (ISCacheItem *)setImageWithIdentifier:(NSString *)identifier
+                                context:(NSString *)context
+                            preferences:(NSDictionary *)preferences
+                                   file:(NSString *)file
+                       placeholderImage:(UIImage *)placeholderImage
+                                  block:(ISCacheCompletionBlock)block;
 - (void)cancelSetImage;
 
 @end
@@ -48,6 +48,24 @@
                             preferences:(NSDictionary *)preferences
                        placeholderImage:(UIImage *)placeholderImage
                                   block:(ISCacheCompletionBlock)block
+{
+  return [self setImageWithIdentifier:identifier
+                              context:context
+                          preferences:preferences
+                                 file:nil
+                     placeholderImage:placeholderImage
+                                block:block];
+}
+
+
+// Loads the named file of the item, allowing a specific rendition
+// to be selected; nil loads the item's sole file.
+- (ISCacheItem *)setImageWithIdentifier:(NSString *)identifier
+                                context:(NSString *)context
+                            preferences:(NSDictionary *)preferences
+                                   file:(NSString *)file
+                       placeholderImage:(UIImage *)placeholderImage
+                                  block:(ISCacheCompletionBlock)block
 {
   ISCache *defaultCache = [ISCache defaultCache];
   
@@ -88,8 +106,20 @@
     
     ISCacheImageView *__weak weakSelf = self;
     ISCacheItem *cacheItem = self.cacheItem;
-    [UIImage loadImage:cacheItem.file.path
-            completion:
+    ISCacheFile *cacheFile = [cacheItem existingFile:file];
+    
+    // Items with multiple files, such as renditions, require the file
+    // to be named.
+    if (cacheFile == nil) {
+      if (self.block) {
+        self.block([NSError errorWithDomain:ISCacheErrorDomain
+                                       code:ISCacheErrorDecodeFailed
+                                   userInfo:nil]);
+      }
+      return;
+    }
+    
+    void (^completion)(NSUInteger identifier, UIImage *image) =
      ^(NSUInteger identifier, UIImage *image) {
        ISCacheImageView *strongSelf = weakSelf;
        
@@ -107,7 +137,28 @@
          self.block(nil);
        }
        
-     }];
+     };
+    
+    // Decodes share the processing queue with other post-processing.
+    // Plain files are loaded from their path; compressed files and
+    // files served from packs have to be decoded from their data.
+    // Interest is held until the decode completes as transient items
+    // are otherwise removed as soon as this block returns.
+    BOOL loadFromPath = (cacheFile.path != nil &&
+                         cacheFile.compression == ISCacheCompressionNone);
+    [cacheItem addInterest];
+    [[ISCacheProcessingQueue defaultQueue] addJob:^{
+      UIImage *image;
+      if (loadFromPath) {
+        image = [UIImage imageWithContentsOfFile:cacheFile.path];
+      } else {
+        image = [UIImage imageWithData:cacheFile.data];
+      }
+      dispatch_async(dispatch_get_main_queue(), ^{
+        completion(0, image);
+        [cacheItem removeInterest];
+      });
+    } cost:cacheFile.length];
     
   }
    cancelToken:self.cancelToken];
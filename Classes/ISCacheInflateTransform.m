@@ -0,0 +1,78 @@
+//
+// Copyright (c) 2013-2014 InSeven Limited.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import "ISCacheInflateTransform.h"
+#import "ISCacheCodec.h"
+#import "ISCache.h"
+
+@interface ISCacheInflateTransform ()
+
+@property (nonatomic, strong) ISCacheCodec *decompressor;
+
+@end
+
+@implementation ISCacheInflateTransform
+
+
+- (id)init
+{
+  self = [super init];
+  if (self) {
+    self.decompressor = [ISCacheCodec gzipDecompressor];
+  }
+  return self;
+}
+
+
+- (NSData *)transformData:(NSData *)data
+                    error:(NSError **)error
+{
+  NSData *output = [self.decompressor processData:data];
+  if (output == nil) {
+    [self _setError:error];
+  }
+  return output;
+}
+
+
+- (NSData *)finishWithError:(NSError **)error
+{
+  // Truncated streams are reported as errors.
+  if (!self.decompressor.streamEnded) {
+    [self _setError:error];
+    return nil;
+  }
+  return [NSData data];
+}
+
+
+- (void)_setError:(NSError **)error
+{
+  if (error) {
+    *error = [NSError errorWithDomain:ISCacheErrorDomain
+                                 code:ISCacheErrorTransformFailed
+                             userInfo:nil];
+  }
+}
+
+
+@end
@@ -27,6 +27,7 @@
 #import "ISCacheBlock.h"
 #import "ISCacheTask.h"
 #import "ISCacheItemObserver.h"
+#import "ISCacheStream.h"
 
 typedef enum {
   
@@ -51,7 +52,7 @@ static const int ISCacheItemTotalBytesUnknown = -1;
 @class ISCache;
 @class ISCacheItem;
 
-@interface ISCacheItem : NSObject <ISCancelable>
+@interface ISCacheItem : NSObject <ISCancelable, ISCacheFileDelegate>
 
 // Read-only properties.
 @property (strong, readonly) NSString *identifier;
@@ -63,6 +64,31 @@ static const int ISCacheItemTotalBytesUnknown = -1;
 @property (strong, readonly) NSDate *modified;
 @property (strong, readonly) NSError *lastError;
 
+// Consecutive failures and the date before which fetches fail
+// immediately; both are cleared when the item is found.
+@property (readonly) NSUInteger failures;
+@property (strong, readonly) NSDate *retryDate;
+
+// Number of parties (tasks, image views, managers) interested in the
+// item. Fetches are cancelled when the last interested party removes
+// its interest, after the cache's interest grace period.
+@property (readonly) NSUInteger interestCount;
+
+// Items served from a mounted pack are always found and are read-only.
+@property (readonly) BOOL packed;
+
+// Date the item was last requested by a client, used to select items
+// for eviction from caches with a disk budget. Access times are saved
+// when the application resigns active and when the cache is released.
+@property (strong, readonly) NSDate *accessed;
+
+// Items rejected by the cache's admission policy are delivered to
+// waiting clients but are transient: they are never recorded as found
+// and are removed once no party is interested in them. Clients which
+// read the files of an item after their completion block returns should
+// hold an interest until they have finished.
+@property (readonly) BOOL transient;
+
 // Read-write properties.
 // TODO These should not be read-write for the normal clients.
 @property (nonatomic) long long totalBytesRead;
@@ -75,20 +101,48 @@ static const int ISCacheItemTotalBytesUnknown = -1;
 @property (readonly) float progress;
 @property (readonly) NSTimeInterval timeRemainingEstimate;
 
+// Total size of the item's files as written and as stored on disk,
+// which may differ when the item's context uses compression.
+@property (readonly) unsigned long long length;
+@property (readonly) unsigned long long storedLength;
+
+// Items may hold multiple named files. -file returns the sole file of
+// items which hold a single file and nil otherwise. -file: creates the
+// named file if it does not exist; readers should use -existingFile:,
+// which returns nil for missing files and, given a nil name, behaves
+// as -file.
 - (NSArray *)files;
 - (ISCacheFile *)file:(NSString *)name;
 - (ISCacheFile *)file;
+- (ISCacheFile *)existingFile:(NSString *)name;
+
+// Returns the named file, stored with the given compression rather
+// than that of the item's context. Handlers which write to the file's
+// path directly must request ISCacheCompressionNone.
+- (ISCacheFile *)file:(NSString *)name
+          compression:(ISCacheCompression)compression;
+- (void)removeFile:(NSString *)name;
+
+// Streams provide access to the contents of a file as it is written,
+// allowing clients to begin consuming in-progress items.
+- (ISCacheStream *)stream;
+- (ISCacheStream *)streamForFile:(NSString *)name;
 
 - (void)fetch;
 - (void)remove;
 - (void)cancel;
 - (void)save;
 
+- (void)addInterest;
+- (void)removeInterest;
+
 - (void)addCacheItemObserver:(id<ISCacheItemObserver>)observer
                      options:(ISCacheItemObserverOptions)options;
 - (void)removeCacheItemObserver:(id<ISCacheItemObserver>)observer;
 - (void)addCacheItemProgressObserver:(id<ISCacheItemProgressObserver>)observer;
 - (void)removeCacheItemProgressObserver:(id<ISCacheItemProgressObserver>)observer;
+- (void)addCacheItemDataObserver:(id<ISCacheItemDataObserver>)observer;
+- (void)removeCacheItemDataObserver:(id<ISCacheItemDataObserver>)observer;
 
 - (ISCacheTask *)then:(ISCacheBlock)completionBlock;
 - (ISCacheTask *)then:(ISCacheBlock)completionBlock
@@ -28,6 +28,7 @@
 #import "ISCachePrivate.h"
 #import "ISCacheItemPrivate.h"
 #import "NSObject+Serialize.h"
+#import "ISCachePackFile.h"
 
 @implementation ISCacheItem
 
@@ -42,6 +43,8 @@ static int kCacheItemVersion = 1;
   if (self) {
     _notifier = [ISNotifier new];
     _progressNotifier = [ISNotifier new];
+    _dataNotifier = [ISNotifier new];
+    _dataCondition = [NSCondition new];
     NSString *queueIdentifier = [NSString stringWithFormat:@"%@%p",
                                  @"uk.co.inseven.cache.",
                                  self];
@@ -57,13 +60,16 @@ static int kCacheItemVersion = 1;
 
 
 - (id)_initWithResultSet:(FMResultSet *)resultSet
+                   files:(NSArray *)files
                     root:(NSString *)root
                    cache:(ISCache *)cache
 {
   self = [self init];
   if (self) {
     _root = root;
+    _cache = cache;
     _fmdbId = [resultSet intForColumn:@"id"];
+    _sequence = [resultSet longLongIntForColumn:@"sequence"];
     _identifier = [resultSet stringForColumn:@"identifier"];
     _context = [resultSet stringForColumn:@"context"];
     _path = [resultSet stringForColumn:@"path"];
@@ -71,17 +77,19 @@ static int kCacheItemVersion = 1;
     _state = [resultSet intForColumn:@"state"];
     _totalBytesRead = [resultSet intForColumn:@"bytesRead"];
     _totalBytesExpectedToRead = [resultSet intForColumn:@"bytesExpectedToRead"];
-    
-    NSString *filename = [resultSet stringForColumn:@"filename"];
-    if ([filename length]) {
-      NSString *fileDirectory =
-      [NSString pathWithComponents:@[self.root, self.path]];
-      ISCacheFile *file =
-      [[ISCacheFile alloc] initWithDirectory:fileDirectory
-                                    filename:filename];
-      [_fileDict setObject:file
-                    forKey:filename];
+    _failures = [resultSet intForColumn:@"failures"];
+    NSTimeInterval retryAfter = [resultSet doubleForColumn:@"retryAfter"];
+    if (retryAfter > 0) {
+      _retryDate = [NSDate dateWithTimeIntervalSince1970:retryAfter];
     }
+    NSTimeInterval accessed = [resultSet doubleForColumn:@"accessed"];
+    if (accessed > 0) {
+      _accessed = [NSDate dateWithTimeIntervalSince1970:accessed];
+    }
+    _savedStoredLength = [resultSet unsignedLongLongIntForColumn:@"storedBytes"];
+    
+    [self _addFiles:files
+          resultSet:resultSet];
     
     _preferences = [NSDictionary dictionaryWithJSON:[resultSet stringForColumn:@"preferences"]];
     _userInfo = [NSDictionary dictionaryWithJSON:[resultSet stringForColumn:@"userInfo"]];
@@ -114,6 +122,109 @@ static int kCacheItemVersion = 1;
 }
 
 
+- (id)_initWithIdentifier:(NSString *)identifier
+                  context:(NSString *)context
+              preferences:(NSDictionary *)preferences
+                      uid:(NSString *)uid
+                     pack:(ISCachePack *)pack
+                    cache:(ISCache *)cache
+{
+  self = [self init];
+  if (self) {
+    _identifier = identifier;
+    _context = context;
+    _preferences = preferences;
+    _uid = uid;
+    _cache = cache;
+    _packed = YES;
+    _state = ISCacheItemStateFound;
+    
+    NSString *filename = [pack filenameForUid:uid];
+    ISCachePackFile *file =
+    [[ISCachePackFile alloc] initWithPack:pack
+                                      uid:uid
+                                 filename:filename];
+    _fileDict = [NSMutableDictionary dictionaryWithObject:file
+                                                   forKey:filename];
+    _totalBytesRead = file.length;
+    _totalBytesExpectedToRead = file.length;
+  }
+  return self;
+}
+
+
+// Applies a row written by another process sharing the cache. Files
+// are replaced in memory only; they belong to the other process.
+- (void)_updateWithResultSet:(FMResultSet *)resultSet
+                       files:(NSArray *)files
+{
+  @synchronized (self) {
+    _fmdbId = [resultSet intForColumn:@"id"];
+    _sequence = [resultSet longLongIntForColumn:@"sequence"];
+    _path = [resultSet stringForColumn:@"path"];
+    _state = [resultSet intForColumn:@"state"];
+    _totalBytesRead = [resultSet intForColumn:@"bytesRead"];
+    _totalBytesExpectedToRead = [resultSet intForColumn:@"bytesExpectedToRead"];
+    _failures = [resultSet intForColumn:@"failures"];
+    NSTimeInterval retryAfter = [resultSet doubleForColumn:@"retryAfter"];
+    _retryDate =
+      retryAfter > 0
+      ? [NSDate dateWithTimeIntervalSince1970:retryAfter]
+      : nil;
+    NSTimeInterval accessed = [resultSet doubleForColumn:@"accessed"];
+    if (accessed > 0) {
+      _accessed = [NSDate dateWithTimeIntervalSince1970:accessed];
+    }
+    _savedStoredLength = [resultSet unsignedLongLongIntForColumn:@"storedBytes"];
+    _userInfo = [NSDictionary dictionaryWithJSON:[resultSet stringForColumn:@"userInfo"]];
+    [self.fileDict removeAllObjects];
+    [self _addFiles:files
+          resultSet:resultSet];
+    [self _notifyObservers];
+  }
+  [self _signalDataWaiters];
+}
+
+
+// Files are recorded in the files table; items saved by earlier
+// versions record a single file in the items table.
+- (void)_addFiles:(NSArray *)files
+        resultSet:(FMResultSet *)resultSet
+{
+  if ([files count]) {
+    for (NSDictionary *file in files) {
+      [self _addFile:file[@"name"]
+         compression:[file[@"compression"] intValue]
+              length:[file[@"logicalBytes"] unsignedLongLongValue]];
+    }
+  } else {
+    NSString *filename = [resultSet stringForColumn:@"filename"];
+    if ([filename length]) {
+      [self _addFile:filename
+         compression:[resultSet intForColumn:@"compression"]
+              length:[resultSet unsignedLongLongIntForColumn:@"logicalBytes"]];
+    }
+  }
+}
+
+
+- (void)_addFile:(NSString *)name
+     compression:(ISCacheCompression)compression
+          length:(unsigned long long)length
+{
+  NSString *fileDirectory =
+  [NSString pathWithComponents:@[self.root, self.path]];
+  ISCacheFile *file =
+  [[ISCacheFile alloc] initWithDirectory:fileDirectory
+                                filename:name
+                             compression:compression
+                                  length:length];
+  file.delegate = self;
+  [self.fileDict setObject:file
+                    forKey:name];
+}
+
+
 - (NSString *)description
 {
   return [NSString stringWithFormat:@"%@:%@ - %@ ", self.context, self.identifier, [self.userInfo JSON]];
@@ -205,12 +316,36 @@ static int kCacheItemVersion = 1;
 
 - (void)save
 {
+  // Pack items are read-only and never recorded in the database, and
+  // transient items are never recorded as found.
+  if (self.packed ||
+      self.transient) {
+    return;
+  }
+  
   assert(self.fmdb);
   
+  // The items table records the sole file, if any, and the totals
+  // across all files; the files table records each file.
+  NSArray *files;
+  @synchronized (self) {
+    files = [self.fileDict allValues];
+  }
+  ISCacheFile *file =
+    [files count] == 1
+    ? files[0]
+    : nil;
   NSString *filename =
-    self.file
-    ? [self.file filename]
+    file
+    ? [file filename]
     : @"";
+  NSNumber *compression = @(file ? file.compression : ISCacheCompressionNone);
+  NSNumber *logicalBytes = @(self.length);
+  self.savedStoredLength = self.storedLength;
+  NSNumber *storedBytes = @(self.savedStoredLength);
+  NSNumber *failures = @(self.failures);
+  NSNumber *retryAfter = @(self.retryDate ? [self.retryDate timeIntervalSince1970] : 0);
+  NSNumber *accessed = @(self.accessed ? [self.accessed timeIntervalSince1970] : 0);
   NSString *preferences =
     self.preferences
     ? [self.preferences JSON]
@@ -220,57 +355,210 @@ static int kCacheItemVersion = 1;
     ? [self.userInfo JSON]
     : @"";
   
+  // Shared caches write the item and its files in a single transaction
+  // so that other processes never observe one without the other. Each
+  // write is stamped with the next value of the store's sequence,
+  // allowing other processes to find the rows which have changed.
+  BOOL shared = self.cache.shared;
+  long long sequence = self.sequence;
+  if (shared) {
+    [self.fmdb beginTransaction];
+    if (![self.fmdb executeUpdate:@"UPDATE counter SET sequence = sequence + 1"]) {
+      [self _abortSave:shared];
+      return;
+    }
+    FMResultSet *s = [self.fmdb executeQuery:@"SELECT sequence FROM counter"];
+    if ([s next]) {
+      sequence = [s longLongIntForColumnIndex:0];
+    }
+    [s close];
+  }
+  
   if (self.fmdbId) {
     
     NSLog(@"Updating...");
-    if (![self.fmdb executeUpdate:@"UPDATE items SET state = ?, bytesRead = ?, bytesExpectedToRead = ?, filename = ?, preferences = ?, userInfo = ? WHERE id = ?", @(self.state), @(self.totalBytesRead), @(self.totalBytesExpectedToRead), filename, preferences, userInfo, @(self.fmdbId)]) {
-      assert(false);
+    if (![self.fmdb executeUpdate:@"UPDATE items SET path = ?, state = ?, bytesRead = ?, bytesExpectedToRead = ?, filename = ?, preferences = ?, userInfo = ?, compression = ?, logicalBytes = ?, storedBytes = ?, failures = ?, retryAfter = ?, accessed = ?, sequence = ? WHERE id = ?", self.path, @(self.state), @(self.totalBytesRead), @(self.totalBytesExpectedToRead), filename, preferences, userInfo, compression, logicalBytes, storedBytes, failures, retryAfter, accessed, @(sequence), @(self.fmdbId)]) {
+      [self _abortSave:shared];
+      return;
     }
     
   } else {
     
+    // In shared caches another process may already have created the
+    // item, in which case its row is kept and the cache reloads the
+    // item from it.
     NSLog(@"Inserting...");
-    if (![self.fmdb executeUpdate:@"INSERT INTO items (identifier, context, path, uid, state, bytesRead, bytesExpectedToRead, filename, preferences, userInfo) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?)", self.identifier, self.context, self.path, self.uid, @(self.state), @(self.totalBytesRead), @(self.totalBytesExpectedToRead), filename, preferences, userInfo]) {
-      assert(false);
+    NSString *insert =
+    shared
+    ? @"INSERT OR IGNORE INTO items (identifier, context, path, uid, state, bytesRead, bytesExpectedToRead, filename, preferences, userInfo, compression, logicalBytes, storedBytes, failures, retryAfter, accessed, sequence) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)"
+    : @"INSERT INTO items (identifier, context, path, uid, state, bytesRead, bytesExpectedToRead, filename, preferences, userInfo, compression, logicalBytes, storedBytes, failures, retryAfter, accessed, sequence) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
+    if (![self.fmdb executeUpdate:insert, self.identifier, self.context, self.path, self.uid, @(self.state), @(self.totalBytesRead), @(self.totalBytesExpectedToRead), filename, preferences, userInfo, compression, logicalBytes, storedBytes, failures, retryAfter, accessed, @(sequence)]) {
+      [self _abortSave:shared];
+      return;
+    }
+    if (shared &&
+        [self.fmdb changes] == 0) {
+      [self.fmdb rollback];
+      return;
     }
     self.fmdbId = [self.fmdb lastInsertRowId];
     
   }
+  
+  if (![self _saveFiles:files]) {
+    [self _abortSave:shared];
+    return;
+  }
+  self.sequence = sequence;
+  
+  if (shared) {
+    [self.fmdb commit];
+  }
+  [self.cache _itemDidSave:self];
+}
+
+
+- (BOOL)_saveFiles:(NSArray *)files
+{
+  if (![self.fmdb executeUpdate:@"DELETE FROM files WHERE uid = ?", self.uid]) {
+    return NO;
+  }
+  for (ISCacheFile *file in files) {
+    if (![self.fmdb executeUpdate:@"INSERT INTO files (uid, name, compression, logicalBytes, storedBytes) VALUES (?, ?, ?, ?, ?)", self.uid, file.filename, @(file.compression), @(file.length), @(file.storedLength)]) {
+      return NO;
+    }
+  }
+  return YES;
+}
+
+
+// Shared caches roll back the transaction before asserting so that a
+// failed save never leaves it open.
+- (void)_abortSave:(BOOL)shared
+{
+  if (shared) {
+    [self.fmdb rollback];
+  }
+  assert(false);
 }
 
 
 - (NSArray *)files
 {
-  return [self.fileDict allKeys];
+  @synchronized (self) {
+    return [self.fileDict allKeys];
+  }
 }
 
 
 - (ISCacheFile *)file:(NSString *)name
 {
-  ISCacheFile *file = [self.fileDict objectForKey:name];
-  if (file == nil) {
-    NSString *fileDirectory =
-    [NSString pathWithComponents:@[self.root, self.path]];
-    file = [[ISCacheFile alloc] initWithDirectory:fileDirectory
-                                         filename:name];
-    [self.fileDict setObject:file
-                      forKey:name];
+  ISCacheFile *file;
+  @synchronized (self) {
+    file = [self.fileDict objectForKey:name];
+  }
+  if (file) {
+    return file;
   }
+  return [self file:name
+        compression:[self.cache compressionForContext:self.context]];
+}
+
+
+- (ISCacheFile *)file:(NSString *)name
+          compression:(ISCacheCompression)compression
+{
+  ISCacheFile *file;
+  @synchronized (self) {
+    file = [self.fileDict objectForKey:name];
+    
+    // Existing contents cannot be read with a different compression.
+    if (file &&
+        file.compression != compression) {
+      [file remove];
+      file = nil;
+    }
+    
+    if (file == nil) {
+      NSString *fileDirectory =
+      [NSString pathWithComponents:@[self.root, self.path]];
+      file = [[ISCacheFile alloc] initWithDirectory:fileDirectory
+                                           filename:name
+                                        compression:compression
+                                             length:0];
+      file.delegate = self;
+      [self.fileDict setObject:file
+                        forKey:name];
+    }
+  }
+  [self _signalDataWaiters];
   return file;
 }
 
 
+- (void)removeFile:(NSString *)name
+{
+  @synchronized (self) {
+    [[self.fileDict objectForKey:name] remove];
+    [self.fileDict removeObjectForKey:name];
+  }
+}
+
+
 - (ISCacheFile *)file
 {
-  if (self.fileDict.count == 0) {
+  return [self existingFile:nil];
+}
+
+
+- (ISCacheFile *)existingFile:(NSString *)name
+{
+  @synchronized (self) {
+    if (name) {
+      return [self.fileDict objectForKey:name];
+    } else if (self.fileDict.count == 1) {
+      return [self.fileDict allValues][0];
+    }
     return nil;
   }
-  
-  // Guard against unexpected behaviour when there are
-  // multiple files.
-  assert(self.fileDict.count == 1);
-  
-  return [self.fileDict allValues][0];
+}
+
+
+- (unsigned long long)length
+{
+  unsigned long long length = 0;
+  @synchronized (self) {
+    for (NSString *name in self.fileDict) {
+      length += [[self.fileDict objectForKey:name] length];
+    }
+  }
+  return length;
+}
+
+
+- (unsigned long long)storedLength
+{
+  unsigned long long storedLength = 0;
+  @synchronized (self) {
+    for (NSString *name in self.fileDict) {
+      storedLength += [[self.fileDict objectForKey:name] storedLength];
+    }
+  }
+  return storedLength;
+}
+
+
+- (ISCacheStream *)stream
+{
+  return [[ISCacheStream alloc] initWithCacheItem:self
+                                         filename:nil];
+}
+
+
+- (ISCacheStream *)streamForFile:(NSString *)name
+{
+  return [[ISCacheStream alloc] initWithCacheItem:self
+                                         filename:name];
 }
 
 
@@ -300,6 +588,49 @@ static int kCacheItemVersion = 1;
 }
 
 
+- (void)addInterest
+{
+  @synchronized (self) {
+    _interestCount++;
+    self.interestGeneration++;
+  }
+}
+
+
+- (void)removeInterest
+{
+  NSUInteger generation;
+  @synchronized (self) {
+    assert(_interestCount > 0);
+    if (_interestCount == 0) {
+      return;
+    }
+    _interestCount--;
+    if (_interestCount > 0) {
+      return;
+    }
+    generation = ++self.interestGeneration;
+  }
+  
+  // Cancel the fetch, or discard a transient item, once the grace
+  // period has elapsed unless interest has been registered in the
+  // meantime, allowing a quick re-request to pick the item back up.
+  NSTimeInterval gracePeriod = self.cache.interestGracePeriod;
+  dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(gracePeriod * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+    @synchronized (self) {
+      if (self.interestGeneration != generation) {
+        return;
+      }
+    }
+    if (self.state == ISCacheItemStateInProgress) {
+      [self.cache cancelItems:@[self]];
+    } else if (self.transient) {
+      [self.cache removeItems:@[self]];
+    }
+  });
+}
+
+
 - (void)setTotalBytesExpectedToRead:(long long)totalBytesExpectedToRead
 {
   assert(_state == ISCacheItemStateInProgress);
@@ -385,6 +716,18 @@ static int kCacheItemVersion = 1;
 }
 
 
+- (void)addCacheItemDataObserver:(id<ISCacheItemDataObserver>)observer
+{
+  [self.dataNotifier addObserver:observer];
+}
+
+
+- (void)removeCacheItemDataObserver:(id<ISCacheItemDataObserver>)observer
+{
+  [self.dataNotifier removeObserver:observer];
+}
+
+
 - (ISCacheTask *)then:(ISCacheBlock)completionBlock
 {
   return [[ISCacheTask alloc] initWithCacheItem:self
@@ -422,6 +765,7 @@ static int kCacheItemVersion = 1;
     }
     
     _state = ISCacheItemStateNotFound;
+    _transient = NO;
     _totalBytesExpectedToRead = ISCacheItemTotalBytesUnknown;
     _totalBytesRead = 0;
     _lastError = nil;
@@ -436,15 +780,67 @@ static int kCacheItemVersion = 1;
 
 - (BOOL)_filesExist
 {
+  NSArray *files;
+  @synchronized (self) {
+    files = [self.fileDict allValues];
+  }
   BOOL result = YES;
-  for (NSString *name in self.fileDict) {
-    ISCacheFile *file = [self.fileDict objectForKey:name];
+  for (ISCacheFile *file in files) {
     result &= [file exists];
   }
   return result;
 }
 
 
+// Moves the item's directory to a new path relative to the cache root
+// and records the new path. Empty directories left behind are removed.
+- (BOOL)_moveToPath:(NSString *)path
+{
+  NSFileManager *fileManager = [NSFileManager new];
+  @synchronized (self) {
+    NSString *source = [NSString pathWithComponents:@[self.root, self.path]];
+    NSString *destination = [NSString pathWithComponents:@[self.root, path]];
+    if ([fileManager fileExistsAtPath:source]) {
+      
+      // Anything at the destination is left over from an earlier move
+      // which did not complete.
+      [fileManager removeItemAtPath:destination
+                              error:nil];
+      [fileManager createDirectoryAtPath:[destination stringByDeletingLastPathComponent]
+             withIntermediateDirectories:YES
+                              attributes:nil
+                                   error:nil];
+      NSError *error;
+      if (![fileManager moveItemAtPath:source
+                                toPath:destination
+                                 error:&error]) {
+        return NO;
+      }
+      
+      for (NSString *parent = [source stringByDeletingLastPathComponent];
+           ![parent isEqualToString:self.root] &&
+           [[fileManager contentsOfDirectoryAtPath:parent error:nil] count] == 0;
+           parent = [parent stringByDeletingLastPathComponent]) {
+        [fileManager removeItemAtPath:parent
+                                error:nil];
+      }
+    }
+    
+    // Files refer to their directory so are recreated for the new path.
+    NSArray *files = [self.fileDict allValues];
+    _path = path;
+    [self.fileDict removeAllObjects];
+    for (ISCacheFile *file in files) {
+      [self _addFile:file.filename
+         compression:file.compression
+              length:file.length];
+    }
+  }
+  [self save];
+  return YES;
+}
+
+
 - (void)_closeFiles
 {
   [self.fileDict enumerateKeysAndObjectsUsingBlock:
@@ -476,6 +872,7 @@ static int kCacheItemVersion = 1;
     _modified = [NSDate new];
     [self _notifyObservers];
   }
+  [self _signalDataWaiters];
 }
 
 
@@ -491,9 +888,12 @@ static int kCacheItemVersion = 1;
     }
     
     _lastError = nil;
+    _failures = 0;
+    _retryDate = nil;
     _state = ISCacheItemStateFound;
     [self _notifyObservers];
   }
+  [self _signalDataWaiters];
 }
 
 
@@ -507,6 +907,7 @@ static int kCacheItemVersion = 1;
     
     [self _notifyObservers];
   }
+  [self _signalDataWaiters];
 }
 
 
@@ -517,6 +918,46 @@ static int kCacheItemVersion = 1;
     _lastError = error;
     [self _notifyObservers];
   }
+  [self _signalDataWaiters];
+}
+
+
+- (void)_recordFailureWithRetryDate:(NSDate *)retryDate
+{
+  @synchronized (self) {
+    _failures++;
+    _retryDate = retryDate;
+  }
+}
+
+
+- (BOOL)_resetFailures
+{
+  @synchronized (self) {
+    if (_failures == 0 &&
+        _retryDate == nil) {
+      return NO;
+    }
+    _failures = 0;
+    _retryDate = nil;
+    return YES;
+  }
+}
+
+
+- (void)_recordAccess
+{
+  @synchronized (self) {
+    _accessed = [NSDate new];
+  }
+}
+
+
+- (void)_markTransient
+{
+  @synchronized (self) {
+    _transient = YES;
+  }
 }
 
 
@@ -529,6 +970,16 @@ static int kCacheItemVersion = 1;
 }
 
 
+#pragma mark - ISCacheFileDelegate
+
+
+- (void)cacheFileDidAppendData:(ISCacheFile *)file
+{
+  [self _signalDataWaiters];
+  [self _notifyDataObservers];
+}
+
+
 #pragma mark - Notifications
 
 
@@ -550,6 +1001,38 @@ static int kCacheItemVersion = 1;
 }
 
 
+// Wakes any streams blocked waiting for data or a state change.
+// Must not be called while holding the item lock.
+- (void)_signalDataWaiters
+{
+  [self.dataCondition lock];
+  [self.dataCondition broadcast];
+  [self.dataCondition unlock];
+}
+
+
+- (void)_notifyDataObservers
+{
+  // Data notifications are coalesced to avoid flooding the main
+  // thread when data is received in many small chunks.
+  if ([self.dataNotifier count] > 0) {
+    @synchronized (self) {
+      if (self.dataNotificationPending) {
+        return;
+      }
+      self.dataNotificationPending = YES;
+    }
+    dispatch_async(dispatch_get_main_queue(), ^{
+      @synchronized (self) {
+        self.dataNotificationPending = NO;
+      }
+      [self.dataNotifier notify:@selector(cacheItemDidReceiveData:)
+                     withObject:self];
+    });
+  }
+}
+
+
 - (void)_notifyProgressObservers
 {
   // Notification always happens on the main thread.
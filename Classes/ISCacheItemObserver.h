@@ -35,3 +35,12 @@
 - (void)cacheItemDidProgress:(ISCacheItem *)cacheItem;
 
 @end
+
+@protocol ISCacheItemDataObserver <NSObject>
+
+// Called on the main thread when new data has been written to one of
+// the item's files while it is in progress. Notifications are coalesced
+// so a single notification may cover multiple writes.
+- (void)cacheItemDidReceiveData:(ISCacheItem *)cacheItem;
+
+@end
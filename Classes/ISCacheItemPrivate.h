@@ -22,6 +22,7 @@
 
 #import <Foundation/Foundation.h>
 #import <ISUtilities/ISNotifier.h>
+#import "ISCachePack.h"
 
 @interface ISCacheItem ()
 
@@ -31,14 +32,24 @@
 @property (nonatomic, strong) NSString *path;
 @property (nonatomic, strong) ISNotifier *notifier;
 @property (nonatomic, strong) ISNotifier *progressNotifier;
+@property (nonatomic, strong) ISNotifier *dataNotifier;
+@property (nonatomic, strong) NSCondition *dataCondition;
+@property (nonatomic, assign) BOOL dataNotificationPending;
 @property (nonatomic, strong) dispatch_queue_t queue;
 @property (nonatomic, assign) uint64_t fmdbId;
+@property (nonatomic, assign) long long sequence;
+@property (nonatomic, assign) NSUInteger interestGeneration;
+
+// Stored length as of the last save, allowing the cache's disk usage
+// to be totalled without examining every file.
+@property (nonatomic, assign) unsigned long long savedStoredLength;
 
 // Used for tracking progress update granularity.
 @property (nonatomic, assign) CGFloat lastProgress;
 @property (nonatomic, strong) NSDate *lastProgressDate;
 
 - (id)_initWithResultSet:(FMResultSet *)resultSet
+                   files:(NSArray *)files
                     root:(NSString *)root
                    cache:(ISCache *)cache;
 - (id)_initWithIdentifier:(NSString *)identifier
@@ -48,12 +59,26 @@
                      root:(NSString *)root
                      path:(NSString *)path
                     cache:(ISCache *)cache;
+- (id)_initWithIdentifier:(NSString *)identifier
+                  context:(NSString *)context
+              preferences:(NSDictionary *)preferences
+                      uid:(NSString *)uid
+                     pack:(ISCachePack *)pack
+                    cache:(ISCache *)cache;
+- (void)_updateWithResultSet:(FMResultSet *)resultSet
+                       files:(NSArray *)files;
 - (void)_transitionToInProgress;
 - (void)_transitionToFound;
 - (void)_transitionToNotFound;
 - (void)_transitionToError:(NSError *)error;
 
 - (void)_updateModified;
+- (void)_recordAccess;
+- (void)_markTransient;
+- (void)_recordFailureWithRetryDate:(NSDate *)retryDate;
+- (BOOL)_resetFailures;
+
+- (BOOL)_moveToPath:(NSString *)path;
 
 - (BOOL)_filesExist;
 
@@ -0,0 +1,43 @@
+//
+// Copyright (c) 2013-2014 InSeven Limited.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+#import "ISCacheUid.h"
+
+@class ISCache;
+
+// Moves item directories into the cache's current layout while the
+// cache remains in use. Items are moved in small batches on the main
+// thread so that no item is moved while it is being fetched; items in
+// progress are left in place and migrated on a later run.
+@interface ISCacheLayoutMigrator : NSObject
+
+@property (nonatomic, readonly) ISCacheLayout layout;
+@property (nonatomic, readonly) NSUInteger itemsMoved;
+@property (nonatomic, readonly, getter = isComplete) BOOL complete;
+
+- (id)initWithCache:(ISCache *)cache
+             layout:(ISCacheLayout)layout;
+- (void)start;
+- (void)cancel;
+
+@end
@@ -0,0 +1,124 @@
+//
+// Copyright (c) 2013-2014 InSeven Limited.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import "ISCacheLayoutMigrator.h"
+#import "ISCache.h"
+#import "ISCachePrivate.h"
+#import "ISCacheItemPrivate.h"
+
+// Number of items examined per batch.
+static const NSUInteger kMigratorBatchSize = 64;
+
+@interface ISCacheLayoutMigrator ()
+
+@property (nonatomic, weak) ISCache *cache;
+@property (nonatomic, assign) ISCacheLayout layout;
+@property (nonatomic, strong) NSArray *items;
+@property (nonatomic, assign) NSUInteger location;
+@property (assign) BOOL cancelled;
+@property (nonatomic, assign) NSUInteger itemsMoved;
+@property (nonatomic, assign) BOOL complete;
+
+@end
+
+@implementation ISCacheLayoutMigrator
+
+
+- (id)initWithCache:(ISCache *)cache
+             layout:(ISCacheLayout)layout
+{
+  self = [super init];
+  if (self) {
+    self.cache = cache;
+    self.layout = layout;
+  }
+  return self;
+}
+
+
+- (void)start
+{
+  assert([NSThread isMainThread]);
+  
+  // Items created after this point use the new layout.
+  self.items = [self.cache allItems];
+  self.location = 0;
+  [self _scheduleBatch];
+}
+
+
+- (void)cancel
+{
+  self.cancelled = YES;
+}
+
+
+#pragma mark - Utilities
+
+
+// Each batch is performed in its own pass of the main queue to avoid
+// blocking the application for large caches.
+- (void)_scheduleBatch
+{
+  dispatch_async(dispatch_get_main_queue(), ^{
+    [self _migrateBatch];
+  });
+}
+
+
+- (void)_migrateBatch
+{
+  ISCache *cache = self.cache;
+  if (self.cancelled || cache == nil) {
+    return;
+  }
+  
+  NSUInteger count = self.items.count;
+  NSRange range = NSMakeRange(self.location, MIN(kMigratorBatchSize, count - self.location));
+  for (ISCacheItem *item in [self.items subarrayWithRange:range]) {
+    if (item.packed ||
+        item.state == ISCacheItemStateInProgress ||
+        [cache.active objectForKey:item.uid] != nil) {
+      continue;
+    }
+    NSString *path = ISCachePathForUid(item.uid, self.layout);
+    if ([item.path isEqualToString:path]) {
+      continue;
+    }
+    if ([item _moveToPath:path]) {
+      self.itemsMoved++;
+    } else {
+      [cache log:@"Unable to move item %@ to %@", item.uid, path];
+    }
+  }
+  
+  self.location = NSMaxRange(range);
+  if (self.location < count) {
+    [self _scheduleBatch];
+  } else {
+    self.complete = YES;
+    [cache log:@"Layout migration complete (%lu items moved)", (unsigned long)self.itemsMoved];
+  }
+}
+
+
+@end
@@ -8,6 +8,7 @@
 
 #import <Foundation/Foundation.h>
 #import "ISCache.h"
+#import "ISCacheConcurrencyController.h"
 
 @class ISCacheManager;
 
@@ -15,6 +16,14 @@
 
 - (void)managerDidChange:(ISCacheManager *)manager;
 
+@optional
+
+// Called when adaptive concurrency changes the number of concurrent
+// fetches. The measurements behind the change are available from the
+// manager's concurrency controller.
+- (void)manager:(ISCacheManager *)manager
+didChangeConcurrencyLimit:(NSUInteger)limit;
+
 @end
 
 @interface ISCacheManager : NSObject
@@ -22,9 +31,30 @@
 
 @property (nonatomic, weak) id<ISCacheManagerDelegate> delegate;
 
+// Number of concurrent fetches when adaptive concurrency is disabled.
+// Defaults to 3.
+@property (nonatomic) NSUInteger maximumConcurrentFetches;
+
+// When enabled, the number of concurrent fetches is determined by the
+// concurrency controller within its configured bounds.
+@property (nonatomic) BOOL adaptive;
+@property (nonatomic, readonly) ISCacheConcurrencyController *concurrencyController;
+
+// The number of concurrent fetches currently permitted.
+@property (nonatomic, readonly) NSUInteger concurrencyLimit;
+
+// Post-processing queue used to apply backpressure to fetches.
+// Exposes queueing statistics such as the average wait time.
+@property (nonatomic, readonly) ISCacheProcessingQueue *processingQueue;
+
 + (instancetype)defaultManager;
 - (void)fetch:(ISCacheItem *)item;
 - (void)remove:(ISCacheItem *)item;
+
+// Fetches the item at low priority: prefetches only start when no
+// other fetches are waiting, and are not included in -items. Fetching
+// a prefetched item promotes it to a normal fetch.
+- (void)prefetch:(ISCacheItem *)item;
 - (NSArray *)items;
 
 @end
@@ -7,6 +7,7 @@
 //
 
 #import "ISCacheManager.h"
+#import "ISCacheProcessingQueue.h"
 
 static ISCacheManager *sCacheManager;
 
@@ -16,10 +17,16 @@ static ISCacheManager *sCacheManager;
 
 @property (nonatomic, strong) NSMutableSet *pending;
 @property (nonatomic, strong) NSMutableSet *active;
+@property (nonatomic, strong) NSMutableOrderedSet *prefetchPending;
+@property (nonatomic, strong) NSMutableSet *prefetching;
+@property (nonatomic, strong, readwrite) ISCacheProcessingQueue *processingQueue;
+@property (nonatomic, strong, readwrite) ISCacheConcurrencyController *concurrencyController;
 
 @end
 
-#define MAX_FETCHES 3
+static const NSUInteger kDefaultMaximumConcurrentFetches = 3;
+static const NSUInteger kDefaultMinimumAdaptiveFetches = 1;
+static const NSUInteger kDefaultMaximumAdaptiveFetches = 8;
 
 @implementation ISCacheManager
 
@@ -39,14 +46,37 @@ static ISCacheManager *sCacheManager;
     self.cacheItems = [[NSMutableSet alloc] init];
     self.pending = [[NSMutableSet alloc] init];
     self.active = [[NSMutableSet alloc] init];
+    self.prefetchPending = [[NSMutableOrderedSet alloc] init];
+    self.prefetching = [[NSMutableSet alloc] init];
+    self.processingQueue = [ISCacheProcessingQueue defaultQueue];
+    self.maximumConcurrentFetches = kDefaultMaximumConcurrentFetches;
+    self.adaptive = NO;
+    self.concurrencyController =
+    [[ISCacheConcurrencyController alloc] initWithLimit:kDefaultMaximumConcurrentFetches
+                                           minimumLimit:kDefaultMinimumAdaptiveFetches
+                                           maximumLimit:kDefaultMaximumAdaptiveFetches];
+    
+    // Resume scheduling when post-processing catches up.
+    NSNotificationCenter *notificationCenter = [NSNotificationCenter defaultCenter];
+    [notificationCenter addObserver:self
+                           selector:@selector(processingQueueDidChange:)
+                               name:ISCacheProcessingQueueDidChangeNotification
+                             object:self.processingQueue];
   }
   return self;
 }
 
+- (void)dealloc
+{
+  NSNotificationCenter *notificationCenter = [NSNotificationCenter defaultCenter];
+  [notificationCenter removeObserver:self];
+}
+
 - (void)fetch:(ISCacheItem *)item
 {
   assert([NSThread isMainThread]);
   if (item.state != ISCacheItemStateFound) {
+    [self _removePrefetch:item];
     [self _add:item];
     [self _scheduleFetch:item];
     [self _processScheduledFetches];
@@ -54,9 +84,28 @@ static ISCacheManager *sCacheManager;
   }
 }
 
+- (void)prefetch:(ISCacheItem *)item
+{
+  assert([NSThread isMainThread]);
+  if (item.state != ISCacheItemStateNotFound ||
+      [self.cacheItems containsObject:item] ||
+      [self.prefetching containsObject:item]) {
+    return;
+  }
+  [self.prefetching addObject:item];
+  [item addCacheItemObserver:self options:0];
+  [item addInterest];
+  [self.prefetchPending addObject:item];
+  [self _processScheduledFetches];
+}
+
 - (void)remove:(ISCacheItem *)item
 {
   assert([NSThread isMainThread]);
+  if ([self.active containsObject:item]) {
+    [self.concurrencyController fetchDidCancel:item];
+  }
+  [self _removePrefetch:item];
   [self _remove:item];
   [item remove];
   [self _processScheduledFetches];
@@ -68,6 +117,7 @@ static ISCacheManager *sCacheManager;
   if (NO == [self.cacheItems containsObject:item]) {
     [self.cacheItems addObject:item];
     [item addCacheItemObserver:self options:0];
+    [item addInterest];
   }
 }
 
@@ -81,6 +131,17 @@ static ISCacheManager *sCacheManager;
   if (YES == [self.items containsObject:item]) {
     [self.cacheItems removeObject:item];
     [item removeCacheItemObserver:self];
+    [item removeInterest];
+  }
+}
+
+- (void)_removePrefetch:(ISCacheItem *)item
+{
+  [self.prefetchPending removeObject:item];
+  if (YES == [self.prefetching containsObject:item]) {
+    [self.prefetching removeObject:item];
+    [item removeCacheItemObserver:self];
+    [item removeInterest];
   }
 }
 
@@ -100,20 +161,56 @@ static ISCacheManager *sCacheManager;
 
 - (void)_processScheduledFetches
 {
+  // Apply backpressure when post-processing is saturated; there is
+  // little value in completing downloads which will only be left
+  // waiting to be processed.
+  if ([self.processingQueue isSaturated]) {
+    return;
+  }
+  
   while ([self.pending count] > 0 &&
-         [self.active count] < MAX_FETCHES) {
+         [self.active count] < self.concurrencyLimit) {
     ISCacheItem *item = [self.pending allObjects][0];
     [self.pending removeObject:item];
     [self.active addObject:item];
+    [self.concurrencyController fetchDidStart:item];
+    [item fetch];
+  }
+  
+  // Prefetches only use capacity which no requested fetch needs.
+  while ([self.pending count] == 0 &&
+         [self.prefetchPending count] > 0 &&
+         [self.active count] < self.concurrencyLimit) {
+    ISCacheItem *item = [self.prefetchPending firstObject];
+    [self.prefetchPending removeObject:item];
+    [self.active addObject:item];
+    [self.concurrencyController fetchDidStart:item];
     [item fetch];
   }
 }
 
+- (NSUInteger)concurrencyLimit
+{
+  if (self.adaptive) {
+    return self.concurrencyController.limit;
+  }
+  return self.maximumConcurrentFetches;
+}
+
 - (NSArray *)items
 {
   return [self.cacheItems allObjects];
 }
 
+#pragma mark - NSNotificationCenter
+
+- (void)processingQueueDidChange:(NSNotification *)notification
+{
+  assert([NSThread isMainThread]);
+  [self _processScheduledFetches];
+  [self.delegate managerDidChange:self];
+}
+
 #pragma mark - ISCacheItemObserver
 
 - (void)cacheItemDidChange:(ISCacheItem *)cacheItem
@@ -121,8 +218,18 @@ static ISCacheManager *sCacheManager;
   // Cache item changed state so we need to notify our delegate.
   assert([NSThread isMainThread]);
   
-  if (cacheItem.state == ISCacheItemStateFound ||
-      cacheItem.state == ISCacheItemStateNotFound) {
+  if (cacheItem.state == ISCacheItemStateFound) {
+    BOOL limitChanged = [self.concurrencyController fetchDidFinish:cacheItem];
+    if (limitChanged && self.adaptive &&
+        [self.delegate respondsToSelector:@selector(manager:didChangeConcurrencyLimit:)]) {
+      [self.delegate manager:self
+   didChangeConcurrencyLimit:self.concurrencyController.limit];
+    }
+    [self _removePrefetch:cacheItem];
+    [self _remove:cacheItem];
+  } else if (cacheItem.state == ISCacheItemStateNotFound) {
+    [self.concurrencyController fetchDidFail:cacheItem];
+    [self _removePrefetch:cacheItem];
     [self _remove:cacheItem];
   }
   
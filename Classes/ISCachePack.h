@@ -0,0 +1,45 @@
+//
+// Copyright (c) 2013-2014 InSeven Limited.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+// Read-only, memory-mapped pack of cache items built ahead of time by
+// ISCachePackWriter. Packs are mounted by caches as a lower layer
+// which is consulted before items are fetched.
+@interface ISCachePack : NSObject
+
+@property (nonatomic, readonly) NSString *path;
+@property (nonatomic, readonly) NSUInteger count;
+
++ (instancetype)packWithPath:(NSString *)path
+                       error:(NSError **)error;
+- (id)initWithPath:(NSString *)path
+             error:(NSError **)error;
+
+- (BOOL)containsUid:(NSString *)uid;
+- (NSString *)filenameForUid:(NSString *)uid;
+
+// Returns the payload without copying; the data refers directly to
+// the mapped pack and keeps it mapped for its lifetime.
+- (NSData *)dataForUid:(NSString *)uid;
+
+@end
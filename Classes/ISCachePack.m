@@ -0,0 +1,156 @@
+//
+// Copyright (c) 2013-2014 InSeven Limited.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import "ISCachePack.h"
+#import "ISCachePackFormatPrivate.h"
+#import "ISCache.h"
+
+@interface ISCachePack ()
+
+@property (nonatomic, strong) NSString *path;
+@property (nonatomic, assign) NSUInteger count;
+@property (nonatomic, strong) NSData *data;
+
+@end
+
+@implementation ISCachePack
+
+
++ (instancetype)packWithPath:(NSString *)path
+                       error:(NSError **)error
+{
+  return [[self alloc] initWithPath:path
+                              error:error];
+}
+
+
+- (id)initWithPath:(NSString *)path
+             error:(NSError **)error
+{
+  self = [super init];
+  if (self) {
+    self.path = path;
+    self.data = [NSData dataWithContentsOfFile:path
+                                       options:NSDataReadingMappedAlways
+                                         error:error];
+    if (self.data == nil) {
+      return nil;
+    }
+    
+    // Validate the header and the bounds of the index.
+    const ISCachePackHeader *header = [self.data bytes];
+    if ([self.data length] < sizeof(ISCachePackHeader) ||
+        memcmp(header->magic, kISCachePackMagic, sizeof(kISCachePackMagic)) != 0 ||
+        CFSwapInt32LittleToHost(header->version) != kISCachePackVersion ||
+        (uint64_t)CFSwapInt32LittleToHost(header->count) * sizeof(ISCachePackEntry) >
+        [self.data length] - sizeof(ISCachePackHeader)) {
+      if (error) {
+        *error = [NSError errorWithDomain:ISCacheErrorDomain
+                                     code:ISCacheErrorInvalidPack
+                                 userInfo:@{NSFilePathErrorKey: path}];
+      }
+      return nil;
+    }
+    self.count = CFSwapInt32LittleToHost(header->count);
+  }
+  return self;
+}
+
+
+- (BOOL)containsUid:(NSString *)uid
+{
+  return [self _entryForUid:uid] != NULL;
+}
+
+
+- (NSString *)filenameForUid:(NSString *)uid
+{
+  const ISCachePackEntry *entry = [self _entryForUid:uid];
+  if (entry == NULL) {
+    return nil;
+  }
+  uint64_t offset = CFSwapInt32LittleToHost(entry->filenameOffset);
+  uint64_t length = CFSwapInt32LittleToHost(entry->filenameLength);
+  if (offset + length > [self.data length]) {
+    return nil;
+  }
+  return [[NSString alloc] initWithBytes:(const char *)[self.data bytes] + offset
+                                  length:(NSUInteger)length
+                                encoding:NSUTF8StringEncoding];
+}
+
+
+- (NSData *)dataForUid:(NSString *)uid
+{
+  const ISCachePackEntry *entry = [self _entryForUid:uid];
+  if (entry == NULL) {
+    return nil;
+  }
+  uint64_t offset = CFSwapInt64LittleToHost(entry->offset);
+  uint64_t length = CFSwapInt64LittleToHost(entry->length);
+  if (offset > [self.data length] ||
+      length > [self.data length] - offset) {
+    return nil;
+  }
+  
+  // The deallocator retains the mapping for the lifetime of the data.
+  NSData *data = self.data;
+  return [[NSData alloc] initWithBytesNoCopy:(char *)[data bytes] + offset
+                                      length:(NSUInteger)length
+                                 deallocator:^(void *bytes, NSUInteger bytesLength) {
+                                   (void)data;
+                                 }];
+}
+
+
+#pragma mark - Utilities
+
+
+// Binary search of the sorted index.
+- (const ISCachePackEntry *)_entryForUid:(NSString *)uid
+{
+  const char *key = [uid UTF8String];
+  if (key == NULL ||
+      strlen(key) != kISCachePackUidLength) {
+    return NULL;
+  }
+  
+  const ISCachePackEntry *entries =
+  (const ISCachePackEntry *)((const char *)[self.data bytes] + sizeof(ISCachePackHeader));
+  NSUInteger lower = 0;
+  NSUInteger upper = self.count;
+  while (lower < upper) {
+    NSUInteger middle = lower + (upper - lower) / 2;
+    int result = memcmp(key, entries[middle].uid, kISCachePackUidLength);
+    if (result == 0) {
+      return &entries[middle];
+    } else if (result < 0) {
+      upper = middle;
+    } else {
+      lower = middle + 1;
+    }
+  }
+  return NULL;
+}
+
+
+@end
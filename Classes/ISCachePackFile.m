@@ -0,0 +1,117 @@
+//
+// Copyright (c) 2013-2014 InSeven Limited.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import "ISCachePackFile.h"
+#import "ISCachePack.h"
+#import "ISCacheExceptions.h"
+
+@interface ISCachePackFile ()
+
+@property (nonatomic, strong) ISCachePack *pack;
+@property (nonatomic, strong) NSString *uid;
+
+@end
+
+@implementation ISCachePackFile
+
+
+- (id)initWithPack:(ISCachePack *)pack
+               uid:(NSString *)uid
+          filename:(NSString *)filename
+{
+  self = [super initWithDirectory:nil
+                         filename:filename];
+  if (self) {
+    self.pack = pack;
+    self.uid = uid;
+  }
+  return self;
+}
+
+
+- (void)open
+{
+  @throw [NSException exceptionWithName:ISCacheExceptionReadOnlyFile
+                                 reason:ISCacheExceptionReadOnlyFileReason
+                               userInfo:nil];
+}
+
+
+- (void)close
+{
+}
+
+
+- (void)appendData:(NSData *)data
+{
+  [self open];
+}
+
+
+- (void)writeData:(NSData *)data
+{
+  [self open];
+}
+
+
+- (void)remove
+{
+}
+
+
+- (BOOL)exists
+{
+  return YES;
+}
+
+
+- (NSString *)path
+{
+  return nil;
+}
+
+
+- (NSFileHandle *)handle
+{
+  return nil;
+}
+
+
+- (NSData *)data
+{
+  return [self.pack dataForUid:self.uid];
+}
+
+
+- (unsigned long long)length
+{
+  return [[self data] length];
+}
+
+
+- (unsigned long long)storedLength
+{
+  return [[self data] length];
+}
+
+
+@end
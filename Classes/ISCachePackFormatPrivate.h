@@ -0,0 +1,51 @@
+//
+// Copyright (c) 2013-2014 InSeven Limited.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+// On-disk layout of pack files. All integers are little-endian.
+//
+// Header
+// Entries, sorted by uid
+// Filenames (UTF-8, not terminated)
+// Payloads, each aligned to kISCachePackAlignment bytes
+
+static const char kISCachePackMagic[4] = {'I', 'S', 'C', 'P'};
+static const uint32_t kISCachePackVersion = 1;
+static const NSUInteger kISCachePackAlignment = 16;
+static const NSUInteger kISCachePackUidLength = 32;
+
+typedef struct {
+  char magic[4];
+  uint32_t version;
+  uint32_t count;
+  uint32_t reserved;
+} ISCachePackHeader;
+
+typedef struct {
+  char uid[32];
+  uint64_t offset;
+  uint64_t length;
+  uint32_t filenameOffset;
+  uint32_t filenameLength;
+  uint64_t reserved;
+} ISCachePackEntry;
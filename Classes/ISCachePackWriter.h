@@ -0,0 +1,42 @@
+//
+// Copyright (c) 2013-2014 InSeven Limited.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+// Builds pack files for mounting with -[ISCache mountPackAtPath:error:].
+// Items are keyed exactly as the cache keys them, so an item added here
+// is found by -[ISCache itemForIdentifier:context:preferences:] with
+// the same arguments.
+@interface ISCachePackWriter : NSObject
+
+@property (nonatomic, readonly) NSUInteger count;
+
+- (void)addData:(NSData *)data
+       filename:(NSString *)filename
+  forIdentifier:(NSString *)identifier
+        context:(NSString *)context
+    preferences:(NSDictionary *)preferences;
+
+- (BOOL)writeToPath:(NSString *)path
+              error:(NSError **)error;
+
+@end
@@ -0,0 +1,120 @@
+//
+// Copyright (c) 2013-2014 InSeven Limited.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import "ISCachePackWriter.h"
+#import "ISCachePackFormatPrivate.h"
+#import "ISCacheUid.h"
+
+@interface ISCachePackWriter ()
+
+@property (nonatomic, strong) NSMutableDictionary *entries;
+
+@end
+
+@implementation ISCachePackWriter
+
+
+- (id)init
+{
+  self = [super init];
+  if (self) {
+    self.entries = [NSMutableDictionary dictionary];
+  }
+  return self;
+}
+
+
+- (NSUInteger)count
+{
+  return [self.entries count];
+}
+
+
+- (void)addData:(NSData *)data
+       filename:(NSString *)filename
+  forIdentifier:(NSString *)identifier
+        context:(NSString *)context
+    preferences:(NSDictionary *)preferences
+{
+  assert(data != nil);
+  assert(filename != nil);
+  NSString *uid = ISCacheUidForItem(identifier, context, preferences);
+  [self.entries setObject:@[data, filename]
+                   forKey:uid];
+}
+
+
+- (BOOL)writeToPath:(NSString *)path
+              error:(NSError **)error
+{
+  NSArray *uids = [[self.entries allKeys] sortedArrayUsingComparator:
+                   ^NSComparisonResult(NSString *a, NSString *b) {
+                     int result = strcmp([a UTF8String], [b UTF8String]);
+                     return result < 0 ? NSOrderedAscending : result > 0 ? NSOrderedDescending : NSOrderedSame;
+                   }];
+  
+  // Lay out the filenames followed by the aligned payloads.
+  NSMutableData *filenames = [NSMutableData data];
+  NSMutableData *index = [NSMutableData dataWithCapacity:[uids count] * sizeof(ISCachePackEntry)];
+  NSUInteger filenamesOffset = sizeof(ISCachePackHeader) + [uids count] * sizeof(ISCachePackEntry);
+  for (NSString *uid in uids) {
+    NSData *filename = [self.entries[uid][1] dataUsingEncoding:NSUTF8StringEncoding];
+    ISCachePackEntry entry;
+    memset(&entry, 0, sizeof(entry));
+    memcpy(entry.uid, [uid UTF8String], kISCachePackUidLength);
+    entry.filenameOffset = CFSwapInt32HostToLittle((uint32_t)(filenamesOffset + [filenames length]));
+    entry.filenameLength = CFSwapInt32HostToLittle((uint32_t)[filename length]);
+    [filenames appendData:filename];
+    [index appendBytes:&entry
+                length:sizeof(entry)];
+  }
+  
+  NSMutableData *payloads = [NSMutableData data];
+  uint64_t payloadsOffset = filenamesOffset + [filenames length];
+  ISCachePackEntry *entries = [index mutableBytes];
+  for (NSUInteger i = 0; i < [uids count]; i++) {
+    NSUInteger padding = (kISCachePackAlignment - (payloadsOffset + [payloads length]) % kISCachePackAlignment) % kISCachePackAlignment;
+    [payloads increaseLengthBy:padding];
+    NSData *data = self.entries[uids[i]][0];
+    entries[i].offset = CFSwapInt64HostToLittle(payloadsOffset + [payloads length]);
+    entries[i].length = CFSwapInt64HostToLittle([data length]);
+    [payloads appendData:data];
+  }
+  
+  ISCachePackHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kISCachePackMagic, sizeof(kISCachePackMagic));
+  header.version = CFSwapInt32HostToLittle(kISCachePackVersion);
+  header.count = CFSwapInt32HostToLittle((uint32_t)[uids count]);
+  
+  NSMutableData *pack = [NSMutableData dataWithBytes:&header
+                                              length:sizeof(header)];
+  [pack appendData:index];
+  [pack appendData:filenames];
+  [pack appendData:payloads];
+  return [pack writeToFile:path
+                   options:NSDataWritingAtomic
+                     error:error];
+}
+
+
+@end
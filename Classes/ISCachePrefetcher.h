@@ -0,0 +1,74 @@
+//
+// Copyright (c) 2013-2014 InSeven Limited.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+@class ISCache;
+@class ISCacheItem;
+@class ISCacheManager;
+
+// Speculatively prefetches the items which usually follow a requested
+// item. The order in which clients request items is recorded per
+// context as a first-order transition table in the cache's database;
+// each request enqueues the most likely successors at low priority
+// through the manager. Prefetches are not recorded as requests.
+//
+// Counts are halved once the transitions from an item have been seen
+// often enough, so that changes in behaviour are picked up, and the
+// transitions of removed or evicted items are forgotten.
+@interface ISCachePrefetcher : NSObject
+
+// Maximum number of items prefetched following each request.
+// Defaults to 2.
+@property (nonatomic) NSUInteger budget;
+
+// Minimum fraction of the transitions from an item which must lead to
+// a successor for it to be prefetched. Defaults to 0.3.
+@property (nonatomic) double minimumConfidence;
+
+// Manager through which predicted items are fetched. Defaults to the
+// default manager.
+@property (nonatomic, strong) ISCacheManager *manager;
+
+// Maximum number of successors remembered for each item; the least
+// likely are forgotten to make room for new ones. Defaults to 8.
+@property (nonatomic) NSUInteger maximumSuccessors;
+
+@property (nonatomic, weak, readonly) ISCache *cache;
+
+// Statistics. Precision is the fraction of prefetched items which were
+// subsequently requested; recall is the fraction of requests which
+// followed an earlier request and had been prefetched.
+@property (nonatomic, readonly) NSUInteger prefetches;
+@property (nonatomic, readonly) NSUInteger requests;
+@property (nonatomic, readonly) NSUInteger hits;
+@property (nonatomic, readonly) double precision;
+@property (nonatomic, readonly) double recall;
+
++ (instancetype)prefetcher;
+
+// Returns the predicted successors of the item, most likely first.
+- (NSArray *)predictionsForItem:(ISCacheItem *)item;
+
+- (void)resetStatistics;
+
+@end
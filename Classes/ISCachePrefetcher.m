@@ -0,0 +1,246 @@
+//
+// Copyright (c) 2013-2014 InSeven Limited.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import "ISCachePrefetcherPrivate.h"
+#import "ISCache.h"
+#import "ISCachePrivate.h"
+#import "ISCacheItemPrivate.h"
+#import "ISCacheManager.h"
+
+static const NSUInteger kDefaultBudget = 2;
+static const double kDefaultMinimumConfidence = 0.3;
+static const NSUInteger kDefaultMaximumSuccessors = 8;
+
+// The counts of the transitions from an item are halved once their
+// total exceeds this.
+static const NSUInteger kMaximumTransitionCount = 64;
+
+// Prefetched items which have not yet been requested are remembered
+// for precision and recall; the oldest are forgotten beyond this.
+static const NSUInteger kMaximumOutstandingPrefetches = 256;
+
+@interface ISCachePrefetcher ()
+
+@property (nonatomic, weak) ISCache *cache;
+@property (nonatomic, strong) NSMutableDictionary *lastRequests;
+@property (nonatomic, strong) NSMutableOrderedSet *outstanding;
+@property (nonatomic, assign) NSUInteger prefetches;
+@property (nonatomic, assign) NSUInteger requests;
+@property (nonatomic, assign) NSUInteger hits;
+
+@end
+
+@implementation ISCachePrefetcher
+
+
++ (instancetype)prefetcher
+{
+  return [self new];
+}
+
+
+- (id)init
+{
+  self = [super init];
+  if (self) {
+    self.budget = kDefaultBudget;
+    self.minimumConfidence = kDefaultMinimumConfidence;
+    self.maximumSuccessors = kDefaultMaximumSuccessors;
+    self.manager = [ISCacheManager defaultManager];
+    self.lastRequests = [NSMutableDictionary dictionaryWithCapacity:3];
+    self.outstanding = [NSMutableOrderedSet orderedSet];
+  }
+  return self;
+}
+
+
+- (double)precision
+{
+  if (self.prefetches == 0) {
+    return 0.0;
+  }
+  return (double)self.hits / self.prefetches;
+}
+
+
+- (double)recall
+{
+  if (self.requests == 0) {
+    return 0.0;
+  }
+  return (double)self.hits / self.requests;
+}
+
+
+- (void)resetStatistics
+{
+  assert([NSThread isMainThread]);
+  self.prefetches = 0;
+  self.requests = 0;
+  self.hits = 0;
+  [self.outstanding removeAllObjects];
+}
+
+
+- (NSArray *)predictionsForItem:(ISCacheItem *)item
+{
+  assert([NSThread isMainThread]);
+  ISCache *cache = self.cache;
+  if (cache == nil) {
+    return @[];
+  }
+  
+  NSMutableArray *targets = [NSMutableArray array];
+  NSMutableArray *counts = [NSMutableArray array];
+  NSUInteger total = 0;
+  FMResultSet *s = [cache.db executeQuery:@"SELECT target, count FROM transitions WHERE context = ? AND source = ? ORDER BY count DESC", item.context, item.uid];
+  while ([s next]) {
+    [targets addObject:[s stringForColumn:@"target"]];
+    [counts addObject:@([s intForColumn:@"count"])];
+    total += [s intForColumn:@"count"];
+  }
+  [s close];
+  
+  NSMutableArray *predictions = [NSMutableArray arrayWithCapacity:self.budget];
+  for (NSUInteger i = 0; i < targets.count && predictions.count < self.budget; i++) {
+    if ([counts[i] doubleValue] / total < self.minimumConfidence) {
+      break;
+    }
+    ISCacheItem *target = [cache itemForUid:targets[i]];
+    if (target) {
+      [predictions addObject:target];
+    }
+  }
+  return predictions;
+}
+
+
+#pragma mark - Private
+
+
+- (void)_attachToCache:(ISCache *)cache
+{
+  self.cache = cache;
+}
+
+
+// Called by the cache whenever a client requests an item.
+- (void)_recordRequestForItem:(ISCacheItem *)item
+{
+  assert([NSThread isMainThread]);
+  ISCache *cache = self.cache;
+  if (cache == nil ||
+      item.packed) {
+    return;
+  }
+  
+  // Repeated requests for the same item are not transitions.
+  NSString *previous = self.lastRequests[item.context];
+  if ([previous isEqualToString:item.uid]) {
+    return;
+  }
+  self.lastRequests[item.context] = item.uid;
+  
+  if (previous) {
+    self.requests++;
+    if ([self.outstanding containsObject:item.uid]) {
+      [self.outstanding removeObject:item.uid];
+      self.hits++;
+    }
+    [cache.db beginTransaction];
+    [cache.db executeUpdate:@"INSERT OR IGNORE INTO transitions (context, source, target, count) VALUES (?, ?, ?, 0)", item.context, previous, item.uid];
+    [cache.db executeUpdate:@"UPDATE transitions SET count = count + 1 WHERE context = ? AND source = ? AND target = ?", item.context, previous, item.uid];
+    [self _trimTransitionsFromSource:previous
+                             context:item.context
+                              target:item.uid];
+    [cache.db commit];
+  }
+  
+  // Predictions are enqueued once the request has been served.
+  dispatch_async(dispatch_get_main_queue(), ^{
+    [self _prefetchSuccessorsOfItem:item];
+  });
+}
+
+
+// Ages the transitions from the source and forgets the least likely
+// successors beyond the maximum, other than the target just recorded.
+- (void)_trimTransitionsFromSource:(NSString *)source
+                           context:(NSString *)context
+                            target:(NSString *)target
+{
+  FMDatabase *db = self.cache.db;
+  NSUInteger total = 0;
+  NSUInteger successors = 0;
+  FMResultSet *s = [db executeQuery:@"SELECT IFNULL(SUM(count), 0), COUNT(*) FROM transitions WHERE context = ? AND source = ?", context, source];
+  if ([s next]) {
+    total = [s intForColumnIndex:0];
+    successors = [s intForColumnIndex:1];
+  }
+  [s close];
+  
+  // Counts are rounded up so that no transition is lost by aging.
+  if (total > kMaximumTransitionCount) {
+    [db executeUpdate:@"UPDATE transitions SET count = (count + 1) / 2 WHERE context = ? AND source = ?", context, source];
+  }
+  
+  if (successors > self.maximumSuccessors) {
+    [db executeUpdate:@"DELETE FROM transitions WHERE rowid IN (SELECT rowid FROM transitions WHERE context = ? AND source = ? AND target != ? ORDER BY count LIMIT ?)", context, source, target, @(successors - self.maximumSuccessors)];
+  }
+}
+
+
+// Called by the cache when an item is removed or evicted.
+- (void)_removeTransitionsForItem:(ISCacheItem *)item
+{
+  assert([NSThread isMainThread]);
+  ISCache *cache = self.cache;
+  if (cache == nil ||
+      item.packed) {
+    return;
+  }
+  [cache.db executeUpdate:@"DELETE FROM transitions WHERE context = ? AND (source = ? OR target = ?)", item.context, item.uid, item.uid];
+  if ([self.lastRequests[item.context] isEqualToString:item.uid]) {
+    [self.lastRequests removeObjectForKey:item.context];
+  }
+}
+
+
+- (void)_prefetchSuccessorsOfItem:(ISCacheItem *)item
+{
+  for (ISCacheItem *prediction in [self predictionsForItem:item]) {
+    if (prediction.state != ISCacheItemStateNotFound ||
+        [self.outstanding containsObject:prediction.uid]) {
+      continue;
+    }
+    [self.cache log:@"Prefetching %@ following %@", prediction.uid, item.uid];
+    [self.outstanding addObject:prediction.uid];
+    if (self.outstanding.count > kMaximumOutstandingPrefetches) {
+      [self.outstanding removeObjectAtIndex:0];
+    }
+    self.prefetches++;
+    [self.manager prefetch:prediction];
+  }
+}
+
+
+@end
@@ -24,10 +24,16 @@
 #import <FMDB/FMDB.h>
 #import "ISCache.h"
 #import "ISCacheStore.h"
+#import "ISCacheReconciler.h"
+#import "ISCacheLayoutMigrator.h"
+#import "ISCachePrefetcherPrivate.h"
 
 @interface ISCache ()
 
 @property (nonatomic, strong) NSMutableDictionary *factories;
+@property (nonatomic, strong) NSMutableDictionary *compression;
+@property (nonatomic, strong) NSMutableDictionary *retryPolicies;
+@property (nonatomic, strong) NSMutableArray *packs;
 @property (nonatomic, strong) NSMutableDictionary *active;
 @property (nonatomic, strong) NSString *documentsPath;
 @property (nonatomic, strong) NSString *identifier;
@@ -36,11 +42,39 @@
 @property (nonatomic, strong) NSFileManager *fileManager;
 @property (nonatomic, assign) UIBackgroundTaskIdentifier backgroundTask;
 @property (nonatomic, strong) FMDatabase *db;
+@property (nonatomic, strong) ISCacheReconciler *reconciler;
+@property (nonatomic, strong) ISCacheLayoutMigrator *migrator;
 
+// Disk accounting. Usage records the bytes counted for each found item
+// and the recently used items are ordered from least to most recent.
+// Access times are written to the database in batches.
+@property (nonatomic, assign) unsigned long long usedBytes;
+@property (nonatomic, strong) NSMutableDictionary *usage;
+@property (nonatomic, strong) NSMutableOrderedSet *recentlyUsed;
+@property (nonatomic, strong) NSMutableSet *accessedItems;
+
+// Shared caches.
+@property (nonatomic, assign) BOOL shared;
+@property (nonatomic, strong) NSString *applicationGroup;
+@property (nonatomic, strong) NSString *owner;
+@property (nonatomic, strong) NSMutableSet *remote;
+@property (nonatomic, assign) long long lastSequence;
+@property (nonatomic, assign) BOOL refreshPending;
+@property (nonatomic, strong) dispatch_source_t leaseTimer;
+
++ (ISCache *)_cacheWithIdentifier:(NSString *)identifier;
+
+- (BOOL)_adoptItem:(ISCacheItem *)cacheItem
+           handler:(id<ISCacheHandler>)handler;
 - (ISCacheItem *)fetchItemForIdentifier:(NSString *)identifier
                                 context:(NSString *)context
                             preferences:(NSDictionary *)preferences;
 - (void)log:(NSString *)message, ...;
 - (void)itemDidUpdate:(ISCacheItem *)item;
+- (void)_itemDidSave:(ISCacheItem *)item;
+- (void)_accountForItem:(ISCacheItem *)item;
+- (void)_saveAccessTimes;
+- (void)_sharedStoreDidChange;
+- (BOOL)_isLeasedElsewhere:(ISCacheItem *)item;
 
 @end
\ No newline at end of file
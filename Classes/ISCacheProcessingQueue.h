@@ -0,0 +1,58 @@
+//
+// Copyright (c) 2013-2014 InSeven Limited.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+// Posted on the main thread whenever the queue transitions between
+// saturated and unsaturated.
+extern NSString *const ISCacheProcessingQueueDidChangeNotification;
+
+@interface ISCacheProcessingQueue : NSObject
+
+// Maximum number of jobs which may run concurrently.
+// Defaults to the number of active processor cores.
+@property (nonatomic) NSUInteger maximumConcurrentJobs;
+
+// Total cost of the jobs which may be running at any one time.
+// A single job whose cost exceeds the budget is still permitted
+// to run, but only when no other jobs are running.
+@property (nonatomic) unsigned long long maximumCost;
+
+// The queue is saturated when jobs are waiting to run. Schedulers
+// should avoid starting new work which will feed the queue while
+// this is the case.
+@property (nonatomic, readonly, getter = isSaturated) BOOL saturated;
+
+@property (nonatomic, readonly) NSUInteger pendingCount;
+@property (nonatomic, readonly) NSUInteger activeCount;
+
+// Queueing statistics.
+@property (nonatomic, readonly) NSTimeInterval lastWaitTime;
+@property (nonatomic, readonly) NSTimeInterval averageWaitTime;
+@property (nonatomic, readonly) NSTimeInterval maximumWaitTime;
+
++ (instancetype)defaultQueue;
+
+- (void)addJob:(dispatch_block_t)job
+          cost:(unsigned long long)cost;
+
+@end
@@ -0,0 +1,274 @@
+//
+// Copyright (c) 2013-2014 InSeven Limited.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import "ISCacheProcessingQueue.h"
+
+NSString *const ISCacheProcessingQueueDidChangeNotification = @"ISCacheProcessingQueueDidChangeNotification";
+
+static const unsigned long long kDefaultMaximumCost = 32 * 1024 * 1024;
+
+@interface ISCacheProcessingJob : NSObject
+
+@property (nonatomic, copy) dispatch_block_t block;
+@property (nonatomic, assign) unsigned long long cost;
+@property (nonatomic, strong) NSDate *enqueued;
+
+@end
+
+@implementation ISCacheProcessingJob
+
+@end
+
+@interface ISCacheProcessingQueue ()
+
+@property (nonatomic, strong) dispatch_queue_t queue;
+@property (nonatomic, strong) NSMutableArray *pending;
+@property (nonatomic, assign) NSUInteger active;
+@property (nonatomic, assign) unsigned long long activeCost;
+@property (nonatomic, assign) BOOL wasSaturated;
+@property (nonatomic, assign) NSUInteger completedCount;
+@property (nonatomic, assign) NSTimeInterval totalWaitTime;
+@property (nonatomic, assign) NSTimeInterval lastWait;
+@property (nonatomic, assign) NSTimeInterval maximumWait;
+
+@end
+
+@implementation ISCacheProcessingQueue
+
+@synthesize maximumConcurrentJobs = _maximumConcurrentJobs;
+@synthesize maximumCost = _maximumCost;
+
+
++ (instancetype)defaultQueue
+{
+  static ISCacheProcessingQueue *sQueue;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    sQueue = [self new];
+  });
+  return sQueue;
+}
+
+
+- (id)init
+{
+  self = [super init];
+  if (self) {
+    NSString *queueIdentifier = [NSString stringWithFormat:@"%@%p",
+                                 @"uk.co.inseven.cache.processing.",
+                                 self];
+    _queue = dispatch_queue_create([queueIdentifier UTF8String],
+                                   DISPATCH_QUEUE_SERIAL);
+    _pending = [NSMutableArray new];
+    _maximumConcurrentJobs = MAX(1, [[NSProcessInfo processInfo] activeProcessorCount]);
+    _maximumCost = kDefaultMaximumCost;
+  }
+  return self;
+}
+
+
+- (void)setMaximumConcurrentJobs:(NSUInteger)maximumConcurrentJobs
+{
+  dispatch_async(self.queue, ^{
+    _maximumConcurrentJobs = MAX(1, maximumConcurrentJobs);
+    [self _processJobs];
+  });
+}
+
+
+- (NSUInteger)maximumConcurrentJobs
+{
+  __block NSUInteger result;
+  dispatch_sync(self.queue, ^{
+    result = _maximumConcurrentJobs;
+  });
+  return result;
+}
+
+
+- (void)setMaximumCost:(unsigned long long)maximumCost
+{
+  dispatch_async(self.queue, ^{
+    _maximumCost = maximumCost;
+    [self _processJobs];
+  });
+}
+
+
+- (unsigned long long)maximumCost
+{
+  __block unsigned long long result;
+  dispatch_sync(self.queue, ^{
+    result = _maximumCost;
+  });
+  return result;
+}
+
+
+- (BOOL)isSaturated
+{
+  __block BOOL result;
+  dispatch_sync(self.queue, ^{
+    result = [self _isSaturated];
+  });
+  return result;
+}
+
+
+- (NSUInteger)pendingCount
+{
+  __block NSUInteger result;
+  dispatch_sync(self.queue, ^{
+    result = self.pending.count;
+  });
+  return result;
+}
+
+
+- (NSUInteger)activeCount
+{
+  __block NSUInteger result;
+  dispatch_sync(self.queue, ^{
+    result = self.active;
+  });
+  return result;
+}
+
+
+- (NSTimeInterval)lastWaitTime
+{
+  __block NSTimeInterval result;
+  dispatch_sync(self.queue, ^{
+    result = self.lastWait;
+  });
+  return result;
+}
+
+
+- (NSTimeInterval)averageWaitTime
+{
+  __block NSTimeInterval result;
+  dispatch_sync(self.queue, ^{
+    if (self.completedCount == 0) {
+      result = 0;
+    } else {
+      result = self.totalWaitTime / self.completedCount;
+    }
+  });
+  return result;
+}
+
+
+- (NSTimeInterval)maximumWaitTime
+{
+  __block NSTimeInterval result;
+  dispatch_sync(self.queue, ^{
+    result = self.maximumWait;
+  });
+  return result;
+}
+
+
+- (void)addJob:(dispatch_block_t)block
+          cost:(unsigned long long)cost
+{
+  ISCacheProcessingJob *job = [ISCacheProcessingJob new];
+  job.block = block;
+  job.cost = cost;
+  job.enqueued = [NSDate date];
+  dispatch_async(self.queue, ^{
+    [self.pending addObject:job];
+    [self _processJobs];
+  });
+}
+
+
+#pragma mark - Utilities
+
+
+// Must be called on the queue.
+// A queue which is busy but has no backlog is not saturated as any
+// new job would run as soon as a running one completes.
+- (BOOL)_isSaturated
+{
+  return self.pending.count > 0;
+}
+
+
+// Must be called on the queue.
+- (void)_processJobs
+{
+  while (self.pending.count > 0 &&
+         self.active < _maximumConcurrentJobs) {
+    
+    // Respect the cost budget; a job which would exceed the budget
+    // waits for running jobs to complete unless nothing is running.
+    ISCacheProcessingJob *job = self.pending[0];
+    if (self.active > 0 &&
+        self.activeCost + job.cost > _maximumCost) {
+      break;
+    }
+    
+    [self.pending removeObjectAtIndex:0];
+    self.active++;
+    self.activeCost += job.cost;
+    
+    // Record the time spent waiting.
+    NSTimeInterval wait = [job.enqueued timeIntervalSinceNow] * -1;
+    self.lastWait = wait;
+    self.totalWaitTime += wait;
+    self.completedCount++;
+    self.maximumWait = MAX(self.maximumWait, wait);
+    
+    dispatch_queue_t queue =
+    dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_BACKGROUND, 0);
+    dispatch_async(queue, ^{
+      job.block();
+      dispatch_async(self.queue, ^{
+        self.active--;
+        self.activeCost -= job.cost;
+        [self _processJobs];
+      });
+    });
+    
+  }
+  
+  [self _notifyIfSaturationChanged];
+}
+
+
+// Must be called on the queue.
+- (void)_notifyIfSaturationChanged
+{
+  BOOL saturated = [self _isSaturated];
+  if (saturated == self.wasSaturated) {
+    return;
+  }
+  self.wasSaturated = saturated;
+  dispatch_async(dispatch_get_main_queue(), ^{
+    [[NSNotificationCenter defaultCenter] postNotificationName:ISCacheProcessingQueueDidChangeNotification
+                                                        object:self];
+  });
+}
+
+
+@end
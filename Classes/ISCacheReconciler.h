@@ -0,0 +1,41 @@
+//
+// Copyright (c) 2013-2014 InSeven Limited.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+@class ISCache;
+
+// Reconciles the items table with the cache directory in the
+// background at low priority: orphaned directories are reclaimed,
+// items whose files are missing are reset and items left in progress
+// by a previous process are returned to the not found state.
+@interface ISCacheReconciler : NSObject
+
+@property (nonatomic, readonly) NSUInteger orphansRemoved;
+@property (nonatomic, readonly) NSUInteger itemsReset;
+@property (nonatomic, readonly, getter = isComplete) BOOL complete;
+
+- (id)initWithCache:(ISCache *)cache;
+- (void)start;
+- (void)cancel;
+
+@end
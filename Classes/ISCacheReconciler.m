@@ -0,0 +1,231 @@
+//
+// Copyright (c) 2013-2014 InSeven Limited.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import "ISCacheReconciler.h"
+#import "ISCache.h"
+#import "ISCachePrivate.h"
+#import "ISCacheItemPrivate.h"
+
+// Number of directory entries or items examined per batch.
+static const NSUInteger kReconcilerBatchSize = 64;
+
+@interface ISCacheReconciler ()
+
+@property (nonatomic, weak) ISCache *cache;
+@property (nonatomic, strong) NSString *documentsPath;
+@property (nonatomic, strong) NSArray *items;
+@property (nonatomic, strong) dispatch_queue_t queue;
+@property (assign) BOOL cancelled;
+@property (nonatomic, assign) NSUInteger orphansRemoved;
+@property (nonatomic, assign) NSUInteger itemsReset;
+@property (nonatomic, assign) BOOL complete;
+
+@end
+
+@implementation ISCacheReconciler
+
+
+- (id)initWithCache:(ISCache *)cache
+{
+  self = [super init];
+  if (self) {
+    self.cache = cache;
+    self.documentsPath = cache.documentsPath;
+    self.queue =
+    dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_BACKGROUND, 0);
+  }
+  return self;
+}
+
+
+- (void)start
+{
+  assert([NSThread isMainThread]);
+  
+  // Snapshot the items loaded at launch; items created after this
+  // point are by definition consistent with the file system.
+  self.items = [self.cache allItems];
+  
+  dispatch_async(dispatch_get_main_queue(), ^{
+    [self _resetInterruptedItems];
+    dispatch_async(self.queue, ^{
+      [self _reclaimOrphans];
+      [self _resetMissingItems];
+      dispatch_async(dispatch_get_main_queue(), ^{
+        self.complete = YES;
+        [self.cache log:
+         @"Reconciliation complete (%lu orphans removed, %lu items reset)",
+         (unsigned long)self.orphansRemoved,
+         (unsigned long)self.itemsReset];
+      });
+    });
+  });
+}
+
+
+- (void)cancel
+{
+  self.cancelled = YES;
+}
+
+
+#pragma mark - Utilities
+
+
+// Items which were in progress when the previous process exited will
+// never complete, so they are returned to the not found state to
+// allow them to be fetched again. Called on the main thread.
+- (void)_resetInterruptedItems
+{
+  ISCache *cache = self.cache;
+  if (self.cancelled || cache == nil) {
+    return;
+  }
+  
+  for (ISCacheItem *item in self.items) {
+    if (item.state == ISCacheItemStateInProgress &&
+        [cache.active objectForKey:item.uid] == nil) {
+      
+      // Items in shared caches may be being fetched by another process.
+      if (cache.shared &&
+          [cache _isLeasedElsewhere:item]) {
+        [cache.remote addObject:item.uid];
+        continue;
+      }
+      
+      [item _transitionToNotFound];
+      [item save];
+      self.itemsReset++;
+    }
+  }
+}
+
+
+// Walks the cache directory removing any directory which does not
+// belong to an item, descending into the shard directories of sharded
+// layouts. Called on the background queue.
+- (void)_reclaimOrphans
+{
+  NSFileManager *fileManager = [NSFileManager new];
+  NSDirectoryEnumerator *enumerator =
+  [fileManager enumeratorAtURL:[NSURL fileURLWithPath:self.documentsPath]
+    includingPropertiesForKeys:nil
+                       options:0
+                  errorHandler:nil];
+  
+  NSMutableArray *batch = [NSMutableArray arrayWithCapacity:kReconcilerBatchSize];
+  for (NSURL *URL in enumerator) {
+    if (self.cancelled) {
+      return;
+    }
+    
+    // Entries are collected by their path relative to the cache
+    // directory, matching the paths recorded by items.
+    NSUInteger level = [enumerator level];
+    NSArray *components = [URL pathComponents];
+    if (level <= ISCacheShardLevels &&
+        ISCacheIsShardName([components lastObject])) {
+      continue;
+    }
+    [enumerator skipDescendants];
+    NSRange range = NSMakeRange(components.count - level, level);
+    [batch addObject:[NSString pathWithComponents:[components subarrayWithRange:range]]];
+    if (batch.count == kReconcilerBatchSize) {
+      [self _reclaimOrphansInBatch:batch];
+      [batch removeAllObjects];
+    }
+  }
+  [self _reclaimOrphansInBatch:batch];
+}
+
+
+- (void)_reclaimOrphansInBatch:(NSArray *)paths
+{
+  if (paths.count == 0) {
+    return;
+  }
+  
+  // Membership is checked on the main thread, and the removal is
+  // performed there, so that items created while reconciling are
+  // never mistaken for orphans.
+  dispatch_sync(dispatch_get_main_queue(), ^{
+    ISCache *cache = self.cache;
+    if (self.cancelled || cache == nil) {
+      return;
+    }
+    for (NSString *path in paths) {
+      ISCacheItem *item = [cache itemForUid:[path lastPathComponent]];
+      if (item == nil ||
+          ![item.path isEqualToString:path]) {
+        [cache log:@"Removing orphaned item directory %@", path];
+        [cache.fileManager removeItemAtPath:[self.documentsPath stringByAppendingPathComponent:path]
+                                      error:nil];
+        self.orphansRemoved++;
+      }
+    }
+  });
+}
+
+
+// Checks that the files of items which are marked as found are present,
+// resetting those which are not. Called on the background queue.
+- (void)_resetMissingItems
+{
+  NSUInteger count = self.items.count;
+  for (NSUInteger location = 0; location < count; location += kReconcilerBatchSize) {
+    if (self.cancelled) {
+      return;
+    }
+    
+    NSRange range = NSMakeRange(location, MIN(kReconcilerBatchSize, count - location));
+    NSMutableArray *missing = [NSMutableArray array];
+    for (ISCacheItem *item in [self.items subarrayWithRange:range]) {
+      if (item.state == ISCacheItemStateFound &&
+          ![item _filesExist]) {
+        [missing addObject:item];
+      }
+    }
+    
+    if (missing.count == 0) {
+      continue;
+    }
+    
+    dispatch_sync(dispatch_get_main_queue(), ^{
+      if (self.cancelled || self.cache == nil) {
+        return;
+      }
+      for (ISCacheItem *item in missing) {
+        // The item may have been refetched in the meantime.
+        if (item.state == ISCacheItemStateFound &&
+            ![item _filesExist]) {
+          [self.cache log:@"Resetting item %@ with missing files", item.uid];
+          [item _transitionToNotFound];
+          [item save];
+          self.itemsReset++;
+        }
+      }
+    });
+  }
+}
+
+
+@end
@@ -0,0 +1,41 @@
+//
+// Copyright (c) 2013-2014 InSeven Limited.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+#import "ISCacheHandlerFactory.h"
+
+// Fetches images over HTTP and, after a single decode, stores a
+// rendition of each of the requested maximum pixel sizes as a named
+// file of the item. Renditions keep the format of the source where
+// possible, otherwise opaque images are stored as JPEG and others as
+// PNG. The original download is discarded and the item fails if any
+// rendition cannot be produced.
+@interface ISCacheRenditionHandlerFactory : NSObject
+<ISCacheHandlerFactory>
+
+@property (nonatomic, readonly) NSArray *renditions;
+
++ (instancetype)factoryWithRenditions:(NSArray *)renditions;
++ (NSString *)nameForRendition:(NSNumber *)rendition;
+- (id)initWithRenditions:(NSArray *)renditions;
+
+@end
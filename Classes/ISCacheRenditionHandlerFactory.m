@@ -0,0 +1,233 @@
+//
+// Copyright (c) 2013-2014 InSeven Limited.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import "ISCacheRenditionHandlerFactory.h"
+#import "ISCache.h"
+#import "ISCacheHTTPHandler.h"
+#import "ISCacheScalingHandlerFactory.h"
+#import <ImageIO/ImageIO.h>
+#import <MobileCoreServices/MobileCoreServices.h>
+
+// Quality used for lossy renditions.
+static const double kRenditionQuality = 0.85;
+
+@interface ISCacheRenditionHandlerFactory ()
+
+@property (nonatomic, strong) NSArray *renditions;
+
+@end
+
+@implementation ISCacheRenditionHandlerFactory
+
+
++ (instancetype)factoryWithRenditions:(NSArray *)renditions
+{
+  return [[self alloc] initWithRenditions:renditions];
+}
+
+
++ (NSString *)nameForRendition:(NSNumber *)rendition
+{
+  return [NSString stringWithFormat:
+          @"%lu",
+          (unsigned long)[rendition unsignedIntegerValue]];
+}
+
+
+- (id)initWithRenditions:(NSArray *)renditions
+{
+  self = [super init];
+  if (self) {
+    self.renditions = renditions;
+  }
+  return self;
+}
+
+
+- (id<ISCacheHandler>)handlerForContext:(NSString *)context
+                               userInfo:(NSDictionary *)userInfo
+{
+  NSArray *renditions = self.renditions;
+  __block __weak ISCacheHTTPHandler *weakHandler;
+  ISCacheHTTPHandler *handler = [[ISCacheHTTPHandler alloc] initWithCompletion:^(ISCacheItem *info) {
+    
+    // The handler owns its completion block so is alive while it runs.
+    NSString *original = weakHandler.filename;
+    ISCacheFile *file = [info existingFile:original];
+    if (file == nil) {
+      return [NSError errorWithDomain:ISCacheErrorDomain
+                                 code:ISCacheErrorDecodeFailed
+                             userInfo:nil];
+    }
+    
+    // Decode the image once, forcing the decode to happen here rather
+    // than lazily for each rendition. Renditions keep the format of the
+    // source where possible so that photographs are not inflated by
+    // lossless encoding.
+    NSData *data = file.data;
+    CGImageSourceRef source = CGImageSourceCreateWithData((__bridge CFDataRef)data, NULL);
+    CGImageRef image = NULL;
+    CFStringRef sourceType = NULL;
+    if (source) {
+      NSDictionary *options = @{(__bridge id)kCGImageSourceShouldCacheImmediately: @YES};
+      image = CGImageSourceCreateImageAtIndex(source, 0, (__bridge CFDictionaryRef)options);
+      sourceType = CGImageSourceGetType(source);
+    }
+    BOOL opaque = image ? [ISCacheRenditionHandlerFactory _isOpaque:image] : NO;
+    CFStringRef type = [ISCacheRenditionHandlerFactory _renditionTypeForSourceType:sourceType
+                                                                            opaque:opaque];
+    if (source) {
+      CFRelease(source);
+    }
+    if (image == NULL) {
+      return [NSError errorWithDomain:ISCacheErrorDomain
+                                 code:ISCacheErrorDecodeFailed
+                             userInfo:nil];
+    }
+    
+    // The original is removed before the renditions are written in
+    // case it shares a name with one of them.
+    [info removeFile:original];
+    
+    // Draw and save each rendition. An item is only found if all of its
+    // renditions could be produced.
+    NSError *error = nil;
+    for (NSNumber *rendition in renditions) {
+      NSData *encoded = [self _renditionOfImage:image
+                                        maximum:[rendition floatValue]
+                                         opaque:opaque
+                                           type:type];
+      if (encoded == nil) {
+        error = [NSError errorWithDomain:ISCacheErrorDomain
+                                    code:ISCacheErrorDecodeFailed
+                                userInfo:nil];
+        break;
+      }
+      [[info file:[ISCacheRenditionHandlerFactory nameForRendition:rendition]] writeData:encoded];
+    }
+    CGImageRelease(image);
+    
+    return error;
+    
+  }];
+  
+  // Charge for the decoded source and a bitmap for each rendition.
+  handler.costBlock = ^(ISCacheItem *info) {
+    unsigned long long cost = [ISCacheScalingHandlerFactory decodedCostForItem:info];
+    for (NSNumber *rendition in renditions) {
+      unsigned long long maximum = [rendition unsignedLongLongValue];
+      cost += maximum * maximum * 4;
+    }
+    return cost;
+  };
+  
+  weakHandler = handler;
+  return handler;
+}
+
+
++ (BOOL)_isOpaque:(CGImageRef)image
+{
+  CGImageAlphaInfo alphaInfo = CGImageGetAlphaInfo(image);
+  return (alphaInfo == kCGImageAlphaNone ||
+          alphaInfo == kCGImageAlphaNoneSkipLast ||
+          alphaInfo == kCGImageAlphaNoneSkipFirst);
+}
+
+
+// JPEG and PNG sources keep their format; other sources are stored as
+// JPEG if they are opaque and PNG otherwise.
++ (CFStringRef)_renditionTypeForSourceType:(CFStringRef)type
+                                    opaque:(BOOL)opaque
+{
+  if (type &&
+      UTTypeEqual(type, kUTTypeJPEG)) {
+    return kUTTypeJPEG;
+  } else if (type &&
+             UTTypeEqual(type, kUTTypePNG)) {
+    return kUTTypePNG;
+  }
+  return opaque ? kUTTypeJPEG : kUTTypePNG;
+}
+
+
+// Scales the image to fit within maximum x maximum pixels, preserving
+// the aspect ratio; images are never scaled up.
+- (NSData *)_renditionOfImage:(CGImageRef)image
+                      maximum:(CGFloat)maximum
+                       opaque:(BOOL)opaque
+                         type:(CFStringRef)type
+{
+  size_t width = CGImageGetWidth(image);
+  size_t height = CGImageGetHeight(image);
+  CGFloat scale = MIN(1.0, MIN(maximum / width, maximum / height));
+  size_t targetWidth = MAX(1, (size_t)round(width * scale));
+  size_t targetHeight = MAX(1, (size_t)round(height * scale));
+  
+  CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
+  CGBitmapInfo alphaInfo = opaque ? kCGImageAlphaNoneSkipLast : kCGImageAlphaPremultipliedLast;
+  CGContextRef context =
+  CGBitmapContextCreate(NULL,
+                        targetWidth,
+                        targetHeight,
+                        8,
+                        0,
+                        colorSpace,
+                        kCGBitmapByteOrderDefault | alphaInfo);
+  CGColorSpaceRelease(colorSpace);
+  if (context == NULL) {
+    return nil;
+  }
+  
+  CGContextSetInterpolationQuality(context, kCGInterpolationHigh);
+  CGContextDrawImage(context,
+                     CGRectMake(0, 0, targetWidth, targetHeight),
+                     image);
+  CGImageRef scaledImage = CGBitmapContextCreateImage(context);
+  CGContextRelease(context);
+  if (scaledImage == NULL) {
+    return nil;
+  }
+  
+  NSMutableData *data = [NSMutableData data];
+  CGImageDestinationRef destination =
+  CGImageDestinationCreateWithData((__bridge CFMutableDataRef)data,
+                                   type,
+                                   1,
+                                   NULL);
+  if (destination) {
+    NSDictionary *properties = @{(__bridge id)kCGImageDestinationLossyCompressionQuality: @(kRenditionQuality)};
+    CGImageDestinationAddImage(destination, scaledImage, (__bridge CFDictionaryRef)properties);
+    if (!CGImageDestinationFinalize(destination)) {
+      data = nil;
+    }
+    CFRelease(destination);
+  } else {
+    data = nil;
+  }
+  CGImageRelease(scaledImage);
+  
+  return data;
+}
+
+
+@end
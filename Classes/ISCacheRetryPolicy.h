@@ -0,0 +1,67 @@
+//
+// Copyright (c) 2013-2014 InSeven Limited.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+// Determines how long failed items are negatively cached before they
+// may be fetched again. Failures back off exponentially from the
+// initial delay with random jitter; errors carrying an HTTP status are
+// additionally held for at least the interval of their status class.
+// Once the maximum number of attempts is reached items are held for
+// the exhausted interval.
+//
+// Connectivity failures (no connection, timeouts, lost connections and
+// failed lookups) say nothing about the resource itself, so they are
+// neither counted towards the maximum attempts nor held; items may be
+// fetched again as soon as connectivity returns.
+@interface ISCacheRetryPolicy : NSObject <NSCopying>
+
+@property (nonatomic) NSTimeInterval initialDelay;
+@property (nonatomic) NSTimeInterval maximumDelay;
+@property (nonatomic) double multiplier;
+
+// Fraction of each delay which is randomized, between 0 and 1.
+@property (nonatomic) double jitter;
+
+@property (nonatomic) NSUInteger maximumAttempts;
+@property (nonatomic) NSTimeInterval exhaustedInterval;
+
+// Minimum intervals for 4xx and 5xx responses. 408 and 429 responses
+// are transient and use the backoff alone.
+@property (nonatomic) NSTimeInterval clientErrorInterval;
+@property (nonatomic) NSTimeInterval serverErrorInterval;
+
++ (instancetype)defaultPolicy;
+
+// Policy which never holds failed items.
++ (instancetype)noRetryPolicy;
+
+// YES if the error indicates a connectivity failure rather than a
+// failure of the resource.
++ (BOOL)isConnectivityError:(NSError *)error;
+
+// Returns the interval for which an item should be held after failing
+// with the error, where failures includes the current failure.
+- (NSTimeInterval)retryIntervalForError:(NSError *)error
+                               failures:(NSUInteger)failures;
+
+@end
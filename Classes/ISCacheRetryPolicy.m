@@ -0,0 +1,147 @@
+//
+// Copyright (c) 2013-2014 InSeven Limited.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import "ISCacheRetryPolicy.h"
+#import "ISCache.h"
+
+@implementation ISCacheRetryPolicy
+
+
++ (instancetype)defaultPolicy
+{
+  return [self new];
+}
+
+
++ (instancetype)noRetryPolicy
+{
+  ISCacheRetryPolicy *policy = [self new];
+  policy.initialDelay = 0;
+  policy.maximumDelay = 0;
+  policy.jitter = 0;
+  policy.maximumAttempts = NSUIntegerMax;
+  policy.exhaustedInterval = 0;
+  policy.clientErrorInterval = 0;
+  policy.serverErrorInterval = 0;
+  return policy;
+}
+
+
++ (BOOL)isConnectivityError:(NSError *)error
+{
+  // Handlers may wrap the underlying URL loading error.
+  NSError *underlyingError = error.userInfo[NSUnderlyingErrorKey];
+  if (underlyingError &&
+      [self isConnectivityError:underlyingError]) {
+    return YES;
+  }
+  
+  if (![error.domain isEqualToString:NSURLErrorDomain]) {
+    return NO;
+  }
+  switch (error.code) {
+    case NSURLErrorNotConnectedToInternet:
+    case NSURLErrorTimedOut:
+    case NSURLErrorNetworkConnectionLost:
+    case NSURLErrorCannotConnectToHost:
+    case NSURLErrorCannotFindHost:
+    case NSURLErrorDNSLookupFailed:
+    case NSURLErrorInternationalRoamingOff:
+    case NSURLErrorCallIsActive:
+    case NSURLErrorDataNotAllowed:
+      return YES;
+    default:
+      return NO;
+  }
+}
+
+
+- (id)init
+{
+  self = [super init];
+  if (self) {
+    self.initialDelay = 1.0;
+    self.maximumDelay = 300.0;
+    self.multiplier = 2.0;
+    self.jitter = 0.25;
+    self.maximumAttempts = 5;
+    self.exhaustedInterval = 3600.0;
+    self.clientErrorInterval = 600.0;
+    self.serverErrorInterval = 0.0;
+  }
+  return self;
+}
+
+
+- (id)copyWithZone:(NSZone *)zone
+{
+  ISCacheRetryPolicy *policy = [[[self class] allocWithZone:zone] init];
+  policy.initialDelay = self.initialDelay;
+  policy.maximumDelay = self.maximumDelay;
+  policy.multiplier = self.multiplier;
+  policy.jitter = self.jitter;
+  policy.maximumAttempts = self.maximumAttempts;
+  policy.exhaustedInterval = self.exhaustedInterval;
+  policy.clientErrorInterval = self.clientErrorInterval;
+  policy.serverErrorInterval = self.serverErrorInterval;
+  return policy;
+}
+
+
+- (NSTimeInterval)retryIntervalForError:(NSError *)error
+                               failures:(NSUInteger)failures
+{
+  if (failures == 0 ||
+      [ISCacheRetryPolicy isConnectivityError:error]) {
+    return 0;
+  }
+  
+  // Exponential backoff with jitter; the jitter only ever shortens the
+  // delay so the maximum delay is respected.
+  NSTimeInterval delay =
+  MIN(self.initialDelay * pow(self.multiplier, failures - 1),
+      self.maximumDelay);
+  double random = (double)arc4random_uniform(UINT32_MAX) / UINT32_MAX;
+  NSTimeInterval interval = delay * (1.0 - self.jitter * random);
+  
+  // Negative caching by status class.
+  if ([error.domain isEqualToString:ISCacheErrorDomain] &&
+      error.code == ISCacheErrorHTTPStatus) {
+    NSInteger statusCode = [error.userInfo[ISCacheErrorStatusCodeKey] integerValue];
+    if (statusCode >= 500) {
+      interval = MAX(interval, self.serverErrorInterval);
+    } else if (statusCode >= 400 &&
+               statusCode != 408 &&
+               statusCode != 429) {
+      interval = MAX(interval, self.clientErrorInterval);
+    }
+  }
+  
+  if (failures >= self.maximumAttempts) {
+    interval = MAX(interval, self.exhaustedInterval);
+  }
+  
+  return interval;
+}
+
+
+@end
@@ -30,4 +30,9 @@ extern const NSString *ISCacheImageScaleMode;
 @interface ISCacheScalingHandlerFactory : NSObject
 <ISCacheHandlerFactory>
 
+// Estimates the memory needed to decode the item's image from its
+// dimensions, without decoding it. Falls back to the downloaded size
+// for compressed files or images whose dimensions can't be read.
++ (unsigned long long)decodedCostForItem:(ISCacheItem *)item;
+
 @end
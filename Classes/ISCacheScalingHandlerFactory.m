@@ -23,6 +23,7 @@
 #import "ISCacheScalingHandlerFactory.h"
 #import "ISCacheHTTPHandler.h"
 #import <ISUtilities/UIImage+Utilities.h>
+#import <ImageIO/ImageIO.h>
 
 const NSString *ISCacheImageWidth = @"width";
 const NSString *ISCacheImageHeight = @"height";
@@ -30,6 +31,30 @@ const NSString *ISCacheImageScaleMode = @"scale";
 
 @implementation ISCacheScalingHandlerFactory
 
++ (unsigned long long)decodedCostForItem:(ISCacheItem *)item
+{
+  ISCacheFile *file = item.file;
+  unsigned long long cost = item.totalBytesRead;
+  if (file.compression != ISCacheCompressionNone) {
+    return cost;
+  }
+  
+  // Only the image header is read to determine the dimensions.
+  CGImageSourceRef source = CGImageSourceCreateWithURL((__bridge CFURLRef)[NSURL fileURLWithPath:file.path], NULL);
+  if (source == NULL) {
+    return cost;
+  }
+  NSDictionary *properties = (__bridge_transfer NSDictionary *)CGImageSourceCopyPropertiesAtIndex(source, 0, NULL);
+  CFRelease(source);
+  unsigned long long width = [properties[(__bridge NSString *)kCGImagePropertyPixelWidth] unsignedLongLongValue];
+  unsigned long long height = [properties[(__bridge NSString *)kCGImagePropertyPixelHeight] unsignedLongLongValue];
+  if (width == 0 ||
+      height == 0) {
+    return cost;
+  }
+  return MAX(cost, width * height * 4);
+}
+
 - (id<ISCacheHandler>)handlerForContext:(NSString *)context
                                userInfo:(NSDictionary *)userInfo
 {
@@ -49,13 +74,15 @@ const NSString *ISCacheImageScaleMode = @"scale";
                                       scalingMode:scale];
             
       // Save the image.
-      [UIImagePNGRepresentation(scaledImage) writeToFile:info.file.path
-                                           atomically:YES];
+      [info.file writeData:UIImagePNGRepresentation(scaledImage)];
     }
     
     return (NSError *)nil;
     
   }];
+  handler.costBlock = ^(ISCacheItem *info) {
+    return [ISCacheScalingHandlerFactory decodedCostForItem:info];
+  };
   return handler;
 }
 
@@ -0,0 +1,56 @@
+//
+// Copyright (c) 2013-2014 InSeven Limited.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+@class ISCacheItem;
+
+// Provides sequential access to the contents of a cache item file
+// as it is written, allowing playback or progressive rendering to
+// begin before the item has been fully fetched.
+@interface ISCacheStream : NSObject
+
+@property (nonatomic, readonly, weak) ISCacheItem *cacheItem;
+@property (nonatomic, readonly) NSString *filename;
+@property (nonatomic, readonly) unsigned long long offset;
+
+// Set if the item failed or was cancelled while streaming.
+@property (nonatomic, readonly) NSError *error;
+
+- (id)initWithCacheItem:(ISCacheItem *)cacheItem
+               filename:(NSString *)filename;
+
+// Blocks until data is available beyond the current offset or the
+// item is no longer in progress. Items which are not found when the
+// stream is opened are waited on until their fetch begins, so streams
+// may be opened before calling -fetch. Returns an empty data object at
+// the end of the file and nil if the item failed. Compressed files are
+// decompressed as they are read. Should not be called on the main
+// thread.
+- (NSData *)readDataOfMaxLength:(NSUInteger)length;
+
+// Returns the data written since the last read without blocking.
+- (NSData *)readAvailableData;
+
+- (void)close;
+
+@end
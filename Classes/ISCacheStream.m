@@ -0,0 +1,237 @@
+//
+// Copyright (c) 2013-2014 InSeven Limited.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import "ISCacheStream.h"
+#import "ISCacheItem.h"
+#import "ISCacheItemPrivate.h"
+
+@interface ISCacheStream ()
+
+@property (nonatomic, weak) ISCacheItem *cacheItem;
+@property (nonatomic, strong) NSString *filename;
+@property (nonatomic, assign) unsigned long long offset;
+@property (nonatomic, strong) NSError *error;
+@property (nonatomic, strong) NSFileHandle *fileHandle;
+@property (nonatomic, assign) unsigned long long storedOffset;
+@property (nonatomic, strong) ISCacheCodec *decompressor;
+@property (nonatomic, strong) NSMutableData *decompressedData;
+@property (nonatomic, strong) NSError *initialError;
+@property (nonatomic, assign) BOOL started;
+
+@end
+
+@implementation ISCacheStream
+
+
+- (id)initWithCacheItem:(ISCacheItem *)cacheItem
+               filename:(NSString *)filename
+{
+  self = [super init];
+  if (self) {
+    self.cacheItem = cacheItem;
+    self.filename = filename;
+    self.offset = 0;
+    self.initialError = cacheItem.lastError;
+    self.decompressedData = [NSMutableData data];
+  }
+  return self;
+}
+
+
+- (void)dealloc
+{
+  [self close];
+}
+
+
+- (NSData *)readDataOfMaxLength:(NSUInteger)length
+{
+  assert(![NSThread isMainThread]);
+  ISCacheItem *cacheItem = self.cacheItem;
+  NSCondition *condition = cacheItem.dataCondition;
+  
+  // Wait for more data or for the item to finish. The timeout guards
+  // against missed signals and items which are released while waiting.
+  // Compressed data may not yield any output until more has been
+  // written, so waiting continues until some output is produced.
+  while (YES) {
+    [condition lock];
+    while ([self.decompressedData length] == 0 &&
+           [self _isWaiting] &&
+           [self _availableLength] <= self.storedOffset) {
+      [condition waitUntilDate:[NSDate dateWithTimeIntervalSinceNow:1.0]];
+    }
+    [condition unlock];
+    
+    NSData *data = [self _readDataOfMaxLength:length];
+    if (data == nil ||
+        [data length] > 0 ||
+        ![self _isWaiting]) {
+      return data;
+    }
+  }
+}
+
+
+- (NSData *)readAvailableData
+{
+  return [self _readDataOfMaxLength:NSUIntegerMax];
+}
+
+
+- (void)close
+{
+  [self.fileHandle closeFile];
+  self.fileHandle = nil;
+}
+
+
+#pragma mark - Utilities
+
+
+// Fetches are started asynchronously, so items which are not found
+// when the stream is opened are waited on until their fetch begins or
+// fails; once started, an item which is no longer found has failed,
+// been cancelled or been removed.
+- (BOOL)_isPending
+{
+  ISCacheItem *cacheItem = self.cacheItem;
+  return (cacheItem != nil &&
+          !self.started &&
+          cacheItem.state == ISCacheItemStateNotFound &&
+          cacheItem.lastError == self.initialError);
+}
+
+
+- (BOOL)_isWaiting
+{
+  ISCacheItem *cacheItem = self.cacheItem;
+  if (cacheItem.state == ISCacheItemStateInProgress) {
+    self.started = YES;
+    return YES;
+  }
+  return [self _isPending];
+}
+
+
+// Length of the stored representation of the file.
+- (unsigned long long)_availableLength
+{
+  ISCacheFile *file = [self.cacheItem existingFile:self.filename];
+  if (file == nil) {
+    return 0;
+  }
+  return file.storedLength;
+}
+
+
+- (NSData *)_readDataOfMaxLength:(NSUInteger)length
+{
+  // Output decompressed by a previous read is returned first.
+  if ([self.decompressedData length] > 0) {
+    return [self _takeDecompressedDataOfMaxLength:length];
+  }
+  
+  ISCacheItem *cacheItem = self.cacheItem;
+  
+  if (cacheItem.state != ISCacheItemStateNotFound) {
+    self.started = YES;
+  } else if ([self _isPending]) {
+    return [NSData data];
+  }
+  
+  // Items which have been cancelled or have failed since the stream
+  // was opened have had their files removed.
+  if (cacheItem == nil ||
+      cacheItem.state == ISCacheItemStateNotFound) {
+    self.error = cacheItem.lastError;
+    [self close];
+    return nil;
+  }
+  
+  ISCacheFile *file = [cacheItem existingFile:self.filename];
+  if (file == nil) {
+    return [NSData data];
+  }
+  
+  unsigned long long available = file.storedLength;
+  if (available <= self.storedOffset) {
+    return [NSData data];
+  }
+  
+  // Files served from packs have no path and are read directly from
+  // their mapped data.
+  if (file.path == nil) {
+    unsigned long long remaining = available - self.storedOffset;
+    NSUInteger count = remaining > length ? length : (NSUInteger)remaining;
+    NSData *data = [file.data subdataWithRange:NSMakeRange((NSUInteger)self.storedOffset, count)];
+    self.storedOffset += [data length];
+    self.offset += [data length];
+    return data;
+  }
+  
+  if (self.fileHandle == nil) {
+    self.fileHandle = [NSFileHandle fileHandleForReadingAtPath:file.path];
+    if (self.fileHandle == nil) {
+      return [NSData data];
+    }
+    if (file.compression != ISCacheCompressionNone) {
+      self.decompressor = [ISCacheCodec decompressor];
+    }
+  }
+  
+  unsigned long long remaining = available - self.storedOffset;
+  NSUInteger count = remaining > length ? length : (NSUInteger)remaining;
+  [self.fileHandle seekToFileOffset:self.storedOffset];
+  NSData *data = [self.fileHandle readDataOfLength:count];
+  self.storedOffset += [data length];
+  
+  if (self.decompressor == nil) {
+    self.offset += [data length];
+    return data;
+  }
+  
+  // Decompressed output may exceed the requested length, in which
+  // case the remainder is held for subsequent reads.
+  data = [self.decompressor processData:data];
+  if (data == nil) {
+    [self close];
+    return nil;
+  }
+  [self.decompressedData appendData:data];
+  return [self _takeDecompressedDataOfMaxLength:length];
+}
+
+
+- (NSData *)_takeDecompressedDataOfMaxLength:(NSUInteger)length
+{
+  NSUInteger count = MIN(length, [self.decompressedData length]);
+  NSData *data = [self.decompressedData subdataWithRange:NSMakeRange(0, count)];
+  [self.decompressedData replaceBytesInRange:NSMakeRange(0, count)
+                                   withBytes:NULL
+                                      length:0];
+  self.offset += count;
+  return data;
+}
+
+
+@end
@@ -30,6 +30,7 @@
 @property (nonatomic, assign) BOOL initialized;
 @property (nonatomic, strong) ISCacheTask *retainCycle;
 @property (nonatomic, strong) ISCacheItem *cacheItem;
+@property (nonatomic, assign) BOOL interested;
 
 @end
 
@@ -58,6 +59,8 @@
     self.completionBlock = completionBlock;
     self.cancelToken = cancelToken;
     self.initialized = NO;
+    self.interested = YES;
+    [self.cacheItem addInterest];
     [self _retain];
     [self.cancelToken addObserver:self];
     [self.cacheItem addCacheItemObserver:self
@@ -81,10 +84,25 @@
 
 - (void)_release
 {
+  [self _removeInterest];
   self.retainCycle = nil;
 }
 
 
+// Tasks hold an interest in their item until they complete or are
+// cancelled; the item is only cancelled once no interest remains.
+- (void)_removeInterest
+{
+  @synchronized (self) {
+    if (!self.interested) {
+      return;
+    }
+    self.interested = NO;
+  }
+  [self.cacheItem removeInterest];
+}
+
+
 #pragma mark - ISCacheItemObserver
 
 
@@ -123,7 +141,7 @@
 - (void)tokenDidCancel
 {
   [self.cacheItem removeCacheItemObserver:self];
-  [self.cacheItem cancel];
+  [self _removeInterest];
 }
 
 
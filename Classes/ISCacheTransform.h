@@ -0,0 +1,41 @@
+//
+// Copyright (c) 2013-2014 InSeven Limited.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+// Streaming stage applied to data as it is received, before it is
+// written to the item's file, allowing data to be decrypted,
+// decompressed or verified without being re-read from disk.
+// Transforms are stateful and should be used for a single fetch.
+@protocol ISCacheTransform <NSObject>
+
+// Returns the output for the chunk, which may be empty. Returns nil
+// and sets the error if the data could not be transformed.
+- (NSData *)transformData:(NSData *)data
+                    error:(NSError **)error;
+
+// Called once all data has been transformed. Returns any remaining
+// output, or nil and sets the error if the data was incomplete or
+// invalid.
+- (NSData *)finishWithError:(NSError **)error;
+
+@end
@@ -0,0 +1,104 @@
+//
+// Copyright (c) 2013-2014 InSeven Limited.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import "ISCacheTransformChain.h"
+
+@interface ISCacheTransformChain ()
+
+@property (nonatomic, strong) NSArray *transforms;
+
+@end
+
+@implementation ISCacheTransformChain
+
+
++ (instancetype)chainWithTransforms:(NSArray *)transforms
+{
+  return [[self alloc] initWithTransforms:transforms];
+}
+
+
+- (id)initWithTransforms:(NSArray *)transforms
+{
+  self = [super init];
+  if (self) {
+    self.transforms = [transforms copy];
+  }
+  return self;
+}
+
+
+- (NSData *)transformData:(NSData *)data
+                    error:(NSError **)error
+{
+  return [self _transformData:data
+                    fromStage:0
+                        error:error];
+}
+
+
+- (NSData *)finishWithError:(NSError **)error
+{
+  // Each stage's remaining output passes through the later stages
+  // before they are finished in turn.
+  NSMutableData *output = [NSMutableData data];
+  for (NSUInteger i = 0; i < [self.transforms count]; i++) {
+    id<ISCacheTransform> transform = self.transforms[i];
+    NSData *data = [transform finishWithError:error];
+    if (data == nil) {
+      return nil;
+    }
+    data = [self _transformData:data
+                      fromStage:i + 1
+                          error:error];
+    if (data == nil) {
+      return nil;
+    }
+    [output appendData:data];
+  }
+  return output;
+}
+
+
+#pragma mark - Utilities
+
+
+- (NSData *)_transformData:(NSData *)data
+                 fromStage:(NSUInteger)stage
+                     error:(NSError **)error
+{
+  for (NSUInteger i = stage; i < [self.transforms count]; i++) {
+    if ([data length] == 0) {
+      break;
+    }
+    id<ISCacheTransform> transform = self.transforms[i];
+    data = [transform transformData:data
+                              error:error];
+    if (data == nil) {
+      return nil;
+    }
+  }
+  return data;
+}
+
+
+@end
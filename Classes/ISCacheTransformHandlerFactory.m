@@ -0,0 +1,63 @@
+//
+// Copyright (c) 2013-2014 InSeven Limited.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+#import "ISCacheTransformHandlerFactory.h"
+
+@interface ISCacheTransformHandlerFactory ()
+
+@property (nonatomic, copy) ISCacheTransformBlock transformBlock;
+@property (nonatomic, copy) ISCachePostProcessBlock completionBlock;
+
+@end
+
+@implementation ISCacheTransformHandlerFactory
+
+
++ (instancetype)factoryWithTransformBlock:(ISCacheTransformBlock)transformBlock
+{
+  return [[self alloc] initWithTransformBlock:transformBlock
+                                   completion:NULL];
+}
+
+
+- (id)initWithTransformBlock:(ISCacheTransformBlock)transformBlock
+                  completion:(ISCachePostProcessBlock)completionBlock
+{
+  self = [super init];
+  if (self) {
+    self.transformBlock = transformBlock;
+    self.completionBlock = completionBlock;
+  }
+  return self;
+}
+
+
+- (id<ISCacheHandler>)handlerForContext:(NSString *)context
+                               userInfo:(NSDictionary *)userInfo
+{
+  return [[ISCacheHTTPHandler alloc] initWithTransform:self.transformBlock(context, userInfo)
+                                            completion:self.completionBlock];
+}
+
+
+@end
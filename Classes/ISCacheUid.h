@@ -0,0 +1,51 @@
+//
+// Copyright (c) 2013-2014 InSeven Limited.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+// Returns the uid identifying an item within a cache. Shared by caches
+// and pack writers so that packs can be built ahead of time.
+extern NSString *ISCacheUidForItem(NSString *identifier,
+                                   NSString *context,
+                                   NSDictionary *preferences);
+
+typedef enum {
+  
+  // Item directories are created directly within the cache directory.
+  ISCacheLayoutFlat = 0,
+  // Item directories are nested within two levels of directories named
+  // by the leading hex digits of their uid ('ab/cd/abcd...'), keeping
+  // directories small in large caches.
+  ISCacheLayoutSharded = 1,
+  
+} ISCacheLayout;
+
+// Depth of the shard directories of ISCacheLayoutSharded.
+static const NSUInteger ISCacheShardLevels = 2;
+
+// Returns the path of an item's directory relative to the cache root.
+extern NSString *ISCachePathForUid(NSString *uid,
+                                   ISCacheLayout layout);
+
+// Returns YES if the directory name is one of the shard directories
+// used by ISCacheLayoutSharded.
+extern BOOL ISCacheIsShardName(NSString *name);
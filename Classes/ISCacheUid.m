@@ -0,0 +1,70 @@
+//
+// Copyright (c) 2013-2014 InSeven Limited.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#import "ISCacheUid.h"
+#import "NSString+Hashes.h"
+
+// Number of hex digits naming each level of shard directories.
+static const NSUInteger kShardNameLength = 2;
+
+NSString *ISCacheUidForItem(NSString *identifier,
+                            NSString *context,
+                            NSDictionary *preferences)
+{
+  if (preferences) {
+    return [[NSString stringWithFormat:
+             @"%@:%@(%@)",
+             context,
+             identifier,
+             preferences] md5];
+  } else {
+    return [[NSString stringWithFormat:
+             @"%@:%@",
+             context,
+             identifier] md5];
+  }
+}
+
+
+NSString *ISCachePathForUid(NSString *uid,
+                            ISCacheLayout layout)
+{
+  if (layout == ISCacheLayoutFlat) {
+    return uid;
+  }
+  NSMutableArray *components = [NSMutableArray arrayWithCapacity:ISCacheShardLevels + 1];
+  for (NSUInteger level = 0; level < ISCacheShardLevels; level++) {
+    [components addObject:[uid substringWithRange:NSMakeRange(level * kShardNameLength, kShardNameLength)]];
+  }
+  [components addObject:uid];
+  return [NSString pathWithComponents:components];
+}
+
+
+BOOL ISCacheIsShardName(NSString *name)
+{
+  if ([name length] != kShardNameLength) {
+    return NO;
+  }
+  NSCharacterSet *hex = [NSCharacterSet characterSetWithCharactersInString:@"0123456789abcdef"];
+  return [[name stringByTrimmingCharactersInSet:hex] length] == 0;
+}
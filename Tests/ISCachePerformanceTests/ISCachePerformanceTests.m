@@ -0,0 +1,160 @@
+//
+//  ISCachePerformanceTests.m
+//  ISCachePerformanceTests
+//
+//  Benchmarks are kept out of the unit tests and are only run on
+//  request through the ISCachePerformanceTests scheme.
+//
+
+#import <XCTest/XCTest.h>
+#import <ISCache/ISCache.h>
+#import "ISCacheTestSupport.h"
+
+static NSString *const kCacheIdentifier = @"performance-test-cache";
+static NSString *const kSizedTestContext = @"SizedTest";
+
+@interface ISCachePerformanceTests : XCTestCase
+
+@end
+
+@implementation ISCachePerformanceTests
+
+// Requests a small working set interleaved with a scan of large items
+// which are never requested again, returning the working set's hit
+// ratio.
+- (double)hitRatioWithAdmissionPolicy:(id<ISCacheAdmissionPolicy>)admissionPolicy
+{
+  const NSUInteger rounds = 400;
+  const NSUInteger workingSet = 20;
+  @autoreleasepool {
+    [[ISCache cacheWithIdentifier:kCacheIdentifier] purge];
+  }
+  ISCache *cache = [ISCache cacheWithIdentifier:kCacheIdentifier];
+  cache.diskBudget = 32 * 1024;
+  cache.admissionPolicy = admissionPolicy;
+  [cache registerFactory:[ISCacheSimpleHandlerFactory factoryWithClass:[ISCacheSizedTestHandler class]]
+              forContext:kSizedTestContext];
+  
+  NSUInteger hits = 0;
+  for (NSUInteger round = 0; round < rounds; round++) {
+    if ([ISCacheSizedTestHandler requestItem:[NSString stringWithFormat:@"hot-%lu", (unsigned long)(round % workingSet)]
+                                      length:1024
+                                     context:kSizedTestContext
+                                       cache:cache]) {
+      hits++;
+    }
+    [ISCacheSizedTestHandler requestItem:[NSString stringWithFormat:@"scan-%lu", (unsigned long)round]
+                                  length:8 * 1024
+                                 context:kSizedTestContext
+                                   cache:cache];
+  }
+  return (double)hits / rounds;
+}
+
+- (void)testAdmissionPoliciesProtectWorkingSet
+{
+  double always = [self hitRatioWithAdmissionPolicy:[ISCacheAlwaysAdmitPolicy policy]];
+  double size = [self hitRatioWithAdmissionPolicy:[ISCacheSizeAdmissionPolicy policyWithMaximumLength:4 * 1024]];
+  double frequency = [self hitRatioWithAdmissionPolicy:[ISCacheFrequencyAdmissionPolicy policyWithCapacity:64]];
+  
+  XCTAssertTrue(frequency > always,
+                @"Check that frequency admission protects the working set from scans.");
+  XCTAssertTrue(size > always,
+                @"Check that size admission protects the working set from large items.");
+}
+
+// Writes and reads back each payload in chunks with the compression.
+- (void)measureCompression:(ISCacheCompression)compression
+{
+  NSString *directory = [NSTemporaryDirectory() stringByAppendingPathComponent:@"compression"];
+  NSDictionary *payloads = @{@"json": ISCacheTestJSONPayload(),
+                             @"random": ISCacheTestRandomPayload()};
+  const NSUInteger chunkSize = 16 * 1024;
+  
+  [self measureBlock:^{
+    for (NSString *name in payloads) {
+      NSData *payload = payloads[name];
+      ISCacheFile *file = [[ISCacheFile alloc] initWithDirectory:directory
+                                                        filename:name
+                                                     compression:compression
+                                                          length:0];
+      [file remove];
+      for (NSUInteger offset = 0; offset < [payload length]; offset += chunkSize) {
+        NSRange range = NSMakeRange(offset, MIN(chunkSize, [payload length] - offset));
+        [file appendData:[payload subdataWithRange:range]];
+      }
+      [file close];
+      XCTAssertEqualObjects([file data], payload,
+                            @"Check that files are read back transparently.");
+      [file remove];
+    }
+  }];
+}
+
+- (void)testUncompressedFilePerformance
+{
+  [self measureCompression:ISCacheCompressionNone];
+}
+
+- (void)testFastCompressionPerformance
+{
+  [self measureCompression:ISCacheCompressionFast];
+}
+
+- (void)testDefaultCompressionPerformance
+{
+  [self measureCompression:ISCacheCompressionDefault];
+}
+
+// Creates, looks up and removes item directories in the layout.
+- (void)measureLayout:(ISCacheLayout)layout
+{
+  NSString *directory = [NSTemporaryDirectory() stringByAppendingPathComponent:@"layout"];
+  NSFileManager *fileManager = [NSFileManager defaultManager];
+  NSData *payload = [@"0123456789" dataUsingEncoding:NSUTF8StringEncoding];
+  const NSUInteger count = 1000;
+  NSMutableArray *paths = [NSMutableArray arrayWithCapacity:count];
+  for (NSUInteger i = 0; i < count; i++) {
+    NSString *uid = ISCacheUidForItem([NSString stringWithFormat:@"%lu", (unsigned long)i], @"Test", nil);
+    [paths addObject:[directory stringByAppendingPathComponent:ISCachePathForUid(uid, layout)]];
+  }
+  
+  [self measureBlock:^{
+    [fileManager removeItemAtPath:directory
+                            error:nil];
+    for (NSString *path in paths) {
+      ISCacheFile *file = [[ISCacheFile alloc] initWithDirectory:path
+                                                        filename:@"data"];
+      [file writeData:payload];
+    }
+    NSUInteger found = 0;
+    for (NSString *path in paths) {
+      BOOL isDirectory = NO;
+      if ([fileManager fileExistsAtPath:path
+                            isDirectory:&isDirectory]) {
+        found++;
+      }
+    }
+    for (NSString *path in paths) {
+      [fileManager removeItemAtPath:path
+                              error:nil];
+    }
+    XCTAssertEqual(found, count,
+                   @"Check that every item directory is found.");
+  }];
+  
+  [fileManager removeItemAtPath:directory
+                          error:nil];
+}
+
+- (void)testFlatLayoutPerformance
+{
+  [self measureLayout:ISCacheLayoutFlat];
+}
+
+- (void)testShardedLayoutPerformance
+{
+  [self measureLayout:ISCacheLayoutSharded];
+}
+
+@end
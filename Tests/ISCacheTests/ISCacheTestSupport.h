@@ -0,0 +1,26 @@
+//
+//  ISCacheTestSupport.h
+//  ISCacheTests
+//
+//  Shared by the unit and performance test targets.
+//
+
+#import <Foundation/Foundation.h>
+#import <ISCache/ISCache.h>
+
+// Handler which immediately writes the number of bytes given by the
+// item's "length" preference.
+@interface ISCacheSizedTestHandler : NSObject <ISCacheHandler>
+
+// Requests the item, fetching it if necessary, and returns YES if it
+// was already found. The handler must be registered for the context.
++ (BOOL)requestItem:(NSString *)identifier
+             length:(NSUInteger)length
+            context:(NSString *)context
+              cache:(ISCache *)cache;
+
+@end
+
+// Compressible text and incompressible binary payloads.
+NSData *ISCacheTestJSONPayload(void);
+NSData *ISCacheTestRandomPayload(void);
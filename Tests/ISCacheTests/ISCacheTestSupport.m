@@ -0,0 +1,75 @@
+//
+//  ISCacheTestSupport.m
+//  ISCacheTests
+//
+//  Shared by the unit and performance test targets.
+//
+
+#import "ISCacheTestSupport.h"
+
+@implementation ISCacheSizedTestHandler
+
++ (BOOL)requestItem:(NSString *)identifier
+             length:(NSUInteger)length
+            context:(NSString *)context
+              cache:(ISCache *)cache
+{
+  ISCacheItem *item = [cache itemForIdentifier:identifier
+                                       context:context
+                                   preferences:@{@"length": @(length)}];
+  if (item.state == ISCacheItemStateFound) {
+    return YES;
+  }
+  [item fetch];
+  while (item.state == ISCacheItemStateInProgress) {
+    [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.001]];
+  }
+  
+  // Allow transient items to be removed.
+  [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.001]];
+  return NO;
+}
+
+- (void)fetchItem:(ISCacheItem *)item
+          updater:(id<ISCacheHandlerUpdater>)updater
+{
+  NSUInteger length = [item.preferences[@"length"] unsignedIntegerValue];
+  [[item file:@"data"] appendData:[NSMutableData dataWithLength:length]];
+  dispatch_async(dispatch_get_main_queue(), ^{
+    [updater itemDidFinish:item];
+  });
+}
+
+- (void)cancel
+{
+}
+
+- (void)finalize
+{
+}
+
+@end
+
+NSData *ISCacheTestJSONPayload(void)
+{
+  NSMutableArray *records = [NSMutableArray array];
+  for (NSInteger i = 0; i < 2000; i++) {
+    [records addObject:@{@"id": @(i),
+                         @"title": [NSString stringWithFormat:@"Item %ld", (long)i],
+                         @"url": [NSString stringWithFormat:@"https://www.example.com/items/%ld.png", (long)i],
+                         @"tags": @[@"cache", @"example", @"payload"]}];
+  }
+  return [NSJSONSerialization dataWithJSONObject:records
+                                         options:0
+                                           error:nil];
+}
+
+NSData *ISCacheTestRandomPayload(void)
+{
+  NSMutableData *data = [NSMutableData dataWithLength:256 * 1024];
+  uint8_t *bytes = [data mutableBytes];
+  for (NSUInteger i = 0; i < [data length]; i++) {
+    bytes[i] = arc4random_uniform(256);
+  }
+  return data;
+}
@@ -8,6 +8,210 @@
 
 #import <XCTest/XCTest.h>
 #import <ISCache/ISCache.h>
+#import <ISCache/ISCacheManager.h>
+#import <CommonCrypto/CommonCrypto.h>
+#import "ISCacheTestSupport.h"
+
+static NSString *const kTestContext = @"Test";
+static NSString *const kSizedTestContext = @"SizedTest";
+static NSString *const kTestChunk = @"0123456789";
+static const NSInteger kTestChunkCount = 4;
+
+// Handler which writes a fixed number of chunks to the item without
+// touching the network, allowing the cache machinery to be tested.
+@interface ISCacheTestHandler : NSObject <ISCacheHandler>
+
+@property (nonatomic, strong) ISCacheItem *cacheItem;
+@property (nonatomic, weak) id<ISCacheHandlerUpdater> updater;
+@property (nonatomic) NSInteger chunks;
+@property (nonatomic) BOOL cancelled;
+
++ (NSInteger)fetchCount;
+
+@end
+
+static NSInteger sFetchCount = 0;
+
+@implementation ISCacheTestHandler
+
++ (NSInteger)fetchCount
+{
+  return sFetchCount;
+}
+
+- (void)fetchItem:(ISCacheItem *)item
+          updater:(id<ISCacheHandlerUpdater>)updater
+{
+  sFetchCount++;
+  self.cacheItem = item;
+  self.updater = updater;
+  self.chunks = 0;
+  [self writeChunk];
+}
+
+- (void)writeChunk
+{
+  if (self.cancelled) {
+    return;
+  }
+  if (self.chunks == kTestChunkCount) {
+    [self.updater itemDidFinish:self.cacheItem];
+    return;
+  }
+  NSData *data = [kTestChunk dataUsingEncoding:NSUTF8StringEncoding];
+  self.cacheItem.totalBytesRead += [data length];
+  [[self.cacheItem file:@"data"] appendData:data];
+  self.chunks++;
+  dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(0.1 * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+    [self writeChunk];
+  });
+}
+
+- (void)cancel
+{
+  self.cancelled = YES;
+  [self.updater itemDidCancel:self.cacheItem];
+}
+
+- (void)finalize
+{
+}
+
+@end
+
+// Handler which fails every fetch with a 404, counting its fetches.
+@interface ISCacheFailingTestHandler : NSObject <ISCacheHandler>
+
++ (NSInteger)fetchCount;
+
+@end
+
+static NSInteger sFailingFetchCount = 0;
+
+@implementation ISCacheFailingTestHandler
+
++ (NSInteger)fetchCount
+{
+  return sFailingFetchCount;
+}
+
+- (void)fetchItem:(ISCacheItem *)item
+          updater:(id<ISCacheHandlerUpdater>)updater
+{
+  sFailingFetchCount++;
+  dispatch_async(dispatch_get_main_queue(), ^{
+    [updater item:item
+ didFailWithError:[NSError errorWithDomain:ISCacheErrorDomain
+                                      code:ISCacheErrorHTTPStatus
+                                  userInfo:@{ISCacheErrorStatusCodeKey: @404}]];
+  });
+}
+
+- (void)cancel
+{
+}
+
+- (void)finalize
+{
+}
+
+@end
+
+// Handler which fails every fetch as if offline, counting its fetches.
+@interface ISCacheOfflineTestHandler : NSObject <ISCacheHandler>
+
++ (NSInteger)fetchCount;
+
+@end
+
+static NSInteger sOfflineFetchCount = 0;
+
+@implementation ISCacheOfflineTestHandler
+
++ (NSInteger)fetchCount
+{
+  return sOfflineFetchCount;
+}
+
+- (void)fetchItem:(ISCacheItem *)item
+          updater:(id<ISCacheHandlerUpdater>)updater
+{
+  sOfflineFetchCount++;
+  dispatch_async(dispatch_get_main_queue(), ^{
+    [updater item:item
+ didFailWithError:[NSError errorWithDomain:NSURLErrorDomain
+                                      code:NSURLErrorNotConnectedToInternet
+                                  userInfo:nil]];
+  });
+}
+
+- (void)cancel
+{
+}
+
+- (void)finalize
+{
+}
+
+@end
+
+// Records the outcome reported by a handler.
+@interface ISCacheTestUpdater : NSObject <ISCacheHandlerUpdater>
+
+@property (nonatomic) BOOL finished;
+@property (nonatomic, strong) NSError *error;
+
+@end
+
+@implementation ISCacheTestUpdater
+
+- (void)itemDidFinish:(ISCacheItem *)info
+{
+  self.finished = YES;
+}
+
+- (void)itemDidCancel:(ISCacheItem *)info
+{
+}
+
+- (void)item:(ISCacheItem *)info
+didFailWithError:(NSError *)error
+{
+  self.error = error;
+}
+
+- (void)log:(NSString *)message, ...
+{
+}
+
+@end
+
+// Allows connection events to be delivered to HTTP handlers without
+// starting a request.
+@interface ISCacheHTTPHandler (Testing)
+
+- (void)setCacheItem:(ISCacheItem *)cacheItem;
+- (void)setUpdater:(id<ISCacheHandlerUpdater>)updater;
+
+@end
+
+// Reattachment is normally driven by session events from a previous
+// process.
+@interface ISCacheBackgroundSession (Testing)
+
+- (NSURLSessionDownloadTask *)downloadTaskForItem:(ISCacheItem *)item
+                                          handler:(ISCacheBackgroundHandler *)handler;
+- (void)removeTask:(NSURLSessionTask *)task;
+- (ISCacheBackgroundHandler *)_handlerForTask:(NSURLSessionDownloadTask *)task;
+
+@end
+
+@interface ISCache (Testing)
+
+- (BOOL)_adoptItem:(ISCacheItem *)cacheItem
+           handler:(id<ISCacheHandler>)handler;
+
+@end
 
 @interface ISCacheTests : XCTestCase
 
@@ -18,6 +222,7 @@
 
 static NSString *const kDownloadURL = @"https://upload.wikimedia.org/wikipedia/commons/c/c8/AudreyHepburn_leggings.jpg";
 static NSString *const kCacheIdentifier = @"test-cache";
+static NSString *const kSharedCacheIdentifier = @"shared-test-cache";
 
 @implementation ISCacheTests
 
@@ -52,6 +257,8 @@ static NSString *const kCacheIdentifier = @"test-cache";
 {
   if (_cache == nil) {
     _cache = [ISCache cacheWithIdentifier:kCacheIdentifier];
+    [_cache registerFactory:[ISCacheSimpleHandlerFactory factoryWithClass:[ISCacheTestHandler class]]
+                 forContext:kTestContext];
   }
   return _cache;
 }
@@ -195,4 +402,1088 @@ static NSString *const kCacheIdentifier = @"test-cache";
                  @"Check for the correct number of files for a download.");
 }
 
+- (void)testProcessingQueueLimitsConcurrency
+{
+  ISCacheProcessingQueue *queue = [ISCacheProcessingQueue new];
+  queue.maximumConcurrentJobs = 2;
+  
+  NSObject *lock = [NSObject new];
+  __block NSInteger running = 0;
+  __block NSInteger peak = 0;
+  __block NSInteger completed = 0;
+  for (NSInteger i = 0; i < 8; i++) {
+    [queue addJob:^{
+      @synchronized(lock) {
+        running++;
+        peak = MAX(peak, running);
+      }
+      [NSThread sleepForTimeInterval:0.05];
+      @synchronized(lock) {
+        running--;
+        completed++;
+      }
+    } cost:0];
+  }
+  
+  [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:1.0]];
+  
+  XCTAssertEqual(completed, 8,
+                 @"Check that all processing jobs complete.");
+  XCTAssertTrue(peak <= 2,
+                @"Check that the processing queue respects the concurrency limit.");
+  XCTAssertTrue(queue.maximumWaitTime > 0,
+                @"Check that processing queue wait times are recorded.");
+}
+
+- (void)testProcessingQueueRespectsCostBudget
+{
+  ISCacheProcessingQueue *queue = [ISCacheProcessingQueue new];
+  queue.maximumConcurrentJobs = 4;
+  queue.maximumCost = 100;
+  
+  dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
+  for (NSInteger i = 0; i < 3; i++) {
+    [queue addJob:^{
+      dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
+    } cost:60];
+  }
+  [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.1]];
+  
+  XCTAssertEqual(queue.activeCount, 1,
+                 @"Check that jobs which would exceed the cost budget wait.");
+  XCTAssertEqual(queue.pendingCount, 2,
+                 @"Check that the remaining jobs are pending.");
+  XCTAssertTrue(queue.isSaturated,
+                @"Check that a queue with pending jobs is saturated.");
+  
+  for (NSInteger i = 0; i < 3; i++) {
+    dispatch_semaphore_signal(semaphore);
+  }
+  [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.2]];
+  XCTAssertEqual(queue.pendingCount, 0,
+                 @"Check that waiting jobs run once the budget allows.");
+}
+
+- (void)testBusyProcessingQueueWithoutBacklogIsNotSaturated
+{
+  ISCacheProcessingQueue *queue = [ISCacheProcessingQueue new];
+  queue.maximumConcurrentJobs = 1;
+  
+  dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
+  [queue addJob:^{
+    dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
+  } cost:0];
+  [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.1]];
+  
+  XCTAssertEqual(queue.activeCount, 1,
+                 @"Check that the job is running.");
+  XCTAssertFalse(queue.isSaturated,
+                 @"Check that a busy queue with no pending jobs is not saturated.");
+  
+  dispatch_semaphore_signal(semaphore);
+}
+
+- (void)testSaturatedProcessingQueuePausesManager
+{
+  ISCacheProcessingQueue *queue = [ISCacheProcessingQueue defaultQueue];
+  NSUInteger maximumConcurrentJobs = queue.maximumConcurrentJobs;
+  queue.maximumConcurrentJobs = 1;
+  
+  // Saturate the queue.
+  dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
+  for (NSInteger i = 0; i < 2; i++) {
+    [queue addJob:^{
+      dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
+    } cost:0];
+  }
+  [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.1]];
+  XCTAssertTrue(queue.isSaturated,
+                @"Check that the queue is saturated.");
+  
+  ISCacheManager *manager = [ISCacheManager new];
+  ISCacheItem *item = [self.cache itemForIdentifier:@"paused"
+                                            context:kTestContext
+                                        preferences:nil];
+  [manager fetch:item];
+  [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.1]];
+  XCTAssertEqual(item.state, ISCacheItemStateNotFound,
+                 @"Check that fetches are not started while the queue is saturated.");
+  
+  // The change notification resumes scheduling.
+  dispatch_semaphore_signal(semaphore);
+  dispatch_semaphore_signal(semaphore);
+  [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:1.0]];
+  XCTAssertEqual(item.state, ISCacheItemStateFound,
+                 @"Check that fetches resume once the queue catches up.");
+  
+  queue.maximumConcurrentJobs = maximumConcurrentJobs;
+}
+
+- (void)testCacheItemStreaming
+{
+  ISCacheItem *item = [self.cache itemForIdentifier:@"stream"
+                                            context:kTestContext
+                                        preferences:nil];
+  ISCacheStream *stream = [item stream];
+  [item fetch];
+  
+  NSMutableData *received = [NSMutableData data];
+  __block BOOL complete = NO;
+  dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+    NSData *data;
+    while ((data = [stream readDataOfMaxLength:4]) && [data length] > 0) {
+      @synchronized(received) {
+        [received appendData:data];
+      }
+    }
+    complete = YES;
+  });
+  
+  [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:2.0]];
+  
+  NSMutableString *expected = [NSMutableString string];
+  for (NSInteger i = 0; i < kTestChunkCount; i++) {
+    [expected appendString:kTestChunk];
+  }
+  XCTAssertTrue(complete,
+                @"Check that streaming completes when the item is found.");
+  XCTAssertEqualObjects(received, [expected dataUsingEncoding:NSUTF8StringEncoding],
+                        @"Check that streamed data matches the written data.");
+}
+
+- (void)testCompressedCacheItemStreaming
+{
+  [self.cache setCompression:ISCacheCompressionDefault
+                  forContext:kTestContext];
+  ISCacheItem *item = [self.cache itemForIdentifier:@"compressed-stream"
+                                            context:kTestContext
+                                        preferences:nil];
+  ISCacheStream *stream = [item stream];
+  [item fetch];
+  
+  NSMutableData *received = [NSMutableData data];
+  __block NSUInteger longestRead = 0;
+  __block BOOL complete = NO;
+  dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+    NSData *data;
+    while ((data = [stream readDataOfMaxLength:4]) && [data length] > 0) {
+      @synchronized(received) {
+        longestRead = MAX(longestRead, [data length]);
+        [received appendData:data];
+      }
+    }
+    complete = YES;
+  });
+  
+  // Data is available to readers before the fetch completes, and
+  // reading it does not disturb the file being written.
+  [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.25]];
+  XCTAssertEqual(item.state, ISCacheItemStateInProgress,
+                 @"Check that the item is still being fetched.");
+  @synchronized(received) {
+    XCTAssertTrue([received length] > 0,
+                  @"Check that compressed data is streamed before the fetch completes.");
+  }
+  XCTAssertTrue([[item file:@"data"].data length] > 0,
+                @"Check that the data written so far can be read.");
+  
+  [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:2.0]];
+  
+  NSMutableString *expected = [NSMutableString string];
+  for (NSInteger i = 0; i < kTestChunkCount; i++) {
+    [expected appendString:kTestChunk];
+  }
+  NSData *expectedData = [expected dataUsingEncoding:NSUTF8StringEncoding];
+  XCTAssertTrue(complete,
+                @"Check that streaming completes when the item is found.");
+  XCTAssertTrue(longestRead <= 4,
+                @"Check that reads never exceed the requested length.");
+  XCTAssertEqualObjects(received, expectedData,
+                        @"Check that streamed data matches the written data.");
+  XCTAssertEqualObjects([item file:@"data"].data, expectedData,
+                        @"Check that reading mid-fetch does not corrupt the file.");
+}
+
+- (void)testMultipleFilesPersist
+{
+  ISCacheItem *item = [self.cache itemForIdentifier:@"renditions"
+                                            context:kTestContext
+                                        preferences:nil];
+  [item fetch];
+  [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:1.0]];
+  
+  // Replace the download with two renditions.
+  NSData *small = [@"small" dataUsingEncoding:NSUTF8StringEncoding];
+  NSData *large = [@"large" dataUsingEncoding:NSUTF8StringEncoding];
+  NSString *smallName = [ISCacheRenditionHandlerFactory nameForRendition:@64];
+  NSString *largeName = [ISCacheRenditionHandlerFactory nameForRendition:@512];
+  [[item file:smallName] writeData:small];
+  [[item file:largeName] writeData:large];
+  [item removeFile:@"data"];
+  [item save];
+  
+  NSString *uid = item.uid;
+  [self closeCache];
+  ISCacheItem *reopenedItem = [self.cache itemForUid:uid];
+  
+  XCTAssertEqualObjects([NSSet setWithArray:reopenedItem.files], ([NSSet setWithObjects:smallName, largeName, nil]),
+                        @"Check that all files of an item persist across cache instances.");
+  XCTAssertEqualObjects([reopenedItem file:smallName].data, small,
+                        @"Check the contents of persisted renditions.");
+  XCTAssertEqual(reopenedItem.length, [small length] + [large length],
+                 @"Check that item lengths sum across files.");
+}
+
+- (void)testRenditionHandlerReplacesDownloadWithRenditions
+{
+  [self.cache registerFactory:[ISCacheRenditionHandlerFactory factoryWithRenditions:@[@64, @256]]
+                   forContext:@"Renditions"];
+  ISCacheItem *item = [self.cache itemForIdentifier:kDownloadURL
+                                            context:@"Renditions"
+                                        preferences:nil];
+  [item fetch];
+  [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:5.0]];
+  
+  NSString *smallName = [ISCacheRenditionHandlerFactory nameForRendition:@64];
+  NSString *largeName = [ISCacheRenditionHandlerFactory nameForRendition:@256];
+  XCTAssertEqual(item.state, ISCacheItemStateFound,
+                 @"Check that rendition items download successfully.");
+  XCTAssertEqualObjects([NSSet setWithArray:item.files], ([NSSet setWithObjects:smallName, largeName, nil]),
+                        @"Check that the download is replaced by its renditions.");
+  NSData *smallData = [item existingFile:smallName].data;
+  UIImage *small = [UIImage imageWithData:smallData];
+  XCTAssertTrue(MAX(small.size.width, small.size.height) <= 64,
+                @"Check that renditions fit within their maximum size.");
+  const uint8_t jpegMarker[] = {0xFF, 0xD8};
+  XCTAssertEqualObjects([smallData subdataWithRange:NSMakeRange(0, 2)], [NSData dataWithBytes:jpegMarker length:2],
+                        @"Check that renditions keep the format of the source.");
+  XCTAssertNil(item.file,
+               @"Check that items with multiple files have no sole file.");
+  XCTAssertNil([item existingFile:@"missing.png"],
+               @"Check that looking up missing files does not create them.");
+  XCTAssertFalse([item.files containsObject:@"missing.png"],
+                 @"Check that looking up missing files does not add them to the item.");
+}
+
+- (void)testConnectivityFailuresRemainRetryable
+{
+  [self.cache registerFactory:[ISCacheSimpleHandlerFactory factoryWithClass:[ISCacheOfflineTestHandler class]]
+                   forContext:@"Offline"];
+  ISCacheItem *item = [self.cache itemForIdentifier:@"offline"
+                                            context:@"Offline"
+                                        preferences:nil];
+  NSInteger fetchCount = [ISCacheOfflineTestHandler fetchCount];
+  ISCacheRetryPolicy *retryPolicy = [self.cache retryPolicyForContext:@"Offline"];
+  
+  // Fail more often than the policy allows attempts.
+  NSUInteger attempts = retryPolicy.maximumAttempts + 1;
+  for (NSUInteger i = 0; i < attempts; i++) {
+    [item fetch];
+    [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.1]];
+  }
+  
+  XCTAssertEqual([ISCacheOfflineTestHandler fetchCount], fetchCount + attempts,
+                 @"Check that every fetch reaches the handler while offline.");
+  XCTAssertEqual(item.failures, 0,
+                 @"Check that connectivity failures are not counted.");
+  XCTAssertNil(item.retryDate,
+               @"Check that connectivity failures are not negatively cached.");
+  XCTAssertEqual(item.lastError.code, NSURLErrorNotConnectedToInternet,
+                 @"Check that the connectivity error is reported.");
+}
+
+- (void)testFailedItemsBackOff
+{
+  [self.cache registerFactory:[ISCacheSimpleHandlerFactory factoryWithClass:[ISCacheFailingTestHandler class]]
+                   forContext:@"Failing"];
+  ISCacheItem *item = [self.cache itemForIdentifier:@"missing"
+                                            context:@"Failing"
+                                        preferences:nil];
+  NSInteger fetchCount = [ISCacheFailingTestHandler fetchCount];
+  [item fetch];
+  [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.5]];
+  
+  XCTAssertEqual(item.failures, 1,
+                 @"Check that failures are counted.");
+  XCTAssertTrue([item.retryDate timeIntervalSinceNow] > 60,
+                @"Check that client errors are negatively cached.");
+  
+  // Repeat fetches fail without reaching the handler.
+  [item fetch];
+  [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.5]];
+  XCTAssertEqual([ISCacheFailingTestHandler fetchCount], fetchCount + 1,
+                 @"Check that fetches inside the backoff window do not reach the handler.");
+  XCTAssertEqual(item.lastError.code, ISCacheErrorRetryDeferred,
+                 @"Check that deferred fetches report the deferral.");
+  
+  // Failures persist across cache instances.
+  NSString *uid = item.uid;
+  NSDate *retryDate = item.retryDate;
+  [self closeCache];
+  ISCacheItem *reopenedItem = [self.cache itemForUid:uid];
+  XCTAssertEqual(reopenedItem.failures, 1,
+                 @"Check that failures persist across cache instances.");
+  XCTAssertEqualWithAccuracy([reopenedItem.retryDate timeIntervalSinceDate:retryDate], 0, 0.001,
+                             @"Check that retry dates persist across cache instances.");
+  
+  // Removing the item clears the failures.
+  [reopenedItem remove];
+  [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.1]];
+  XCTAssertNil(reopenedItem.retryDate,
+               @"Check that removing an item clears its failures.");
+}
+
+- (void)testRetryPolicyBacksOffExponentially
+{
+  ISCacheRetryPolicy *policy = [ISCacheRetryPolicy defaultPolicy];
+  policy.jitter = 0;
+  NSError *error = [NSError errorWithDomain:NSURLErrorDomain
+                                       code:NSURLErrorTimedOut
+                                   userInfo:nil];
+  XCTAssertEqual([policy retryIntervalForError:error failures:1], policy.initialDelay,
+                 @"Check the initial delay.");
+  XCTAssertEqual([policy retryIntervalForError:error failures:3], policy.initialDelay * 4,
+                 @"Check that delays grow exponentially.");
+  XCTAssertEqual([policy retryIntervalForError:error failures:policy.maximumAttempts], policy.exhaustedInterval,
+                 @"Check that exhausted items are held for the exhausted interval.");
+}
+
+- (void)testSharedFetchSurvivesPartialCancellation
+{
+  ISCacheItem *item = [self.cache itemForIdentifier:@"shared"
+                                            context:kTestContext
+                                        preferences:nil];
+  __block BOOL completed = NO;
+  ISCacheTask *first = [item then:^(NSError *error, ISCancelToken *cancelToken) {}];
+  [item then:^(NSError *error, ISCancelToken *cancelToken) {
+    completed = (error == nil);
+  }];
+  XCTAssertEqual(item.interestCount, 2,
+                 @"Check that each task registers its interest.");
+  
+  [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.05]];
+  [first cancel];
+  [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:1.0]];
+  
+  XCTAssertTrue(completed,
+                @"Check that cancelling one task does not cancel a shared fetch.");
+  XCTAssertEqual(item.interestCount, 0,
+                 @"Check that completed tasks release their interest.");
+}
+
+- (void)testFetchCancelledWithLastInterest
+{
+  ISCacheItem *item = [self.cache itemForIdentifier:@"abandoned"
+                                            context:kTestContext
+                                        preferences:nil];
+  ISCacheTask *task = [item then:^(NSError *error, ISCancelToken *cancelToken) {}];
+  [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.05]];
+  XCTAssertEqual(item.state, ISCacheItemStateInProgress,
+                 @"Check that the task starts the fetch.");
+  
+  [task cancel];
+  [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.1]];
+  XCTAssertEqual(item.state, ISCacheItemStateNotFound,
+                 @"Check that the fetch is cancelled when the last interest is removed.");
+}
+
+- (void)testSharedCachesFetchItemsOnce
+{
+  @autoreleasepool {
+    ISCache *first = [ISCache sharedCacheWithIdentifier:kSharedCacheIdentifier
+                                       applicationGroup:nil];
+    ISCache *second = [ISCache sharedCacheWithIdentifier:kSharedCacheIdentifier
+                                        applicationGroup:nil];
+    for (ISCache *cache in @[first, second]) {
+      [cache registerFactory:[ISCacheSimpleHandlerFactory factoryWithClass:[ISCacheTestHandler class]]
+                  forContext:kTestContext];
+    }
+    NSInteger fetchCount = [ISCacheTestHandler fetchCount];
+    
+    ISCacheItem *firstItem = [first itemForIdentifier:@"shared"
+                                              context:kTestContext
+                                          preferences:nil];
+    [firstItem fetch];
+    [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.05]];
+    ISCacheItem *secondItem = [second itemForIdentifier:@"shared"
+                                                context:kTestContext
+                                            preferences:nil];
+    [secondItem fetch];
+    XCTAssertEqual(secondItem.state, ISCacheItemStateInProgress,
+                   @"Check that the item is in progress while leased by another cache.");
+    [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:1.0]];
+    
+    XCTAssertEqual(firstItem.state, ISCacheItemStateFound,
+                   @"Check that the leasing cache fetches the item.");
+    XCTAssertEqual(secondItem.state, ISCacheItemStateFound,
+                   @"Check that the other cache picks up the fetched item.");
+    XCTAssertEqual([ISCacheTestHandler fetchCount], fetchCount + 1,
+                   @"Check that the item is only fetched once.");
+  }
+  
+  @autoreleasepool {
+    ISCache *cache = [ISCache cacheWithIdentifier:kSharedCacheIdentifier];
+    XCTAssertTrue([cache purge], @"Checking a successful cache purge.");
+  }
+}
+
+- (void)testPackItemsFoundWithoutFetching
+{
+  NSData *payload = [kTestChunk dataUsingEncoding:NSUTF8StringEncoding];
+  ISCachePackWriter *writer = [ISCachePackWriter new];
+  for (NSInteger i = 0; i < 16; i++) {
+    [writer addData:[[NSString stringWithFormat:@"%ld", (long)i] dataUsingEncoding:NSUTF8StringEncoding]
+           filename:@"data"
+      forIdentifier:[NSString stringWithFormat:@"packed-%ld", (long)i]
+            context:kTestContext
+        preferences:nil];
+  }
+  [writer addData:payload
+         filename:@"data"
+    forIdentifier:@"packed"
+          context:kTestContext
+      preferences:@{@"KeyA": @"ValueA"}];
+  NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:@"test.pack"];
+  NSError *error;
+  XCTAssertTrue([writer writeToPath:path error:&error],
+                @"Check that packs can be written (%@).", error);
+  XCTAssertTrue([self.cache mountPackAtPath:path error:&error],
+                @"Check that packs can be mounted (%@).", error);
+  
+  ISCacheItem *item = [self.cache itemForIdentifier:@"packed"
+                                            context:kTestContext
+                                        preferences:@{@"KeyA": @"ValueA"}];
+  XCTAssertTrue(item.packed,
+                @"Check that pack items are served from the pack.");
+  XCTAssertEqual(item.state, ISCacheItemStateFound,
+                 @"Check that pack items are found without fetching.");
+  XCTAssertEqualObjects(item.file.data, payload,
+                        @"Check the contents of pack items.");
+  
+  ISCacheItem *missingItem = [self.cache itemForIdentifier:@"packed"
+                                                   context:kTestContext
+                                               preferences:nil];
+  XCTAssertFalse(missingItem.packed,
+                 @"Check that items absent from the pack fall through to the cache.");
+  
+  // Pack items are not recorded in the database.
+  NSString *uid = item.uid;
+  [self closeCache];
+  XCTAssertNil([self.cache itemForUid:uid],
+               @"Check that pack items are not persisted.");
+}
+
+- (NSData *)transformData:(NSData *)data
+              withTransform:(id<ISCacheTransform>)transform
+                      error:(NSError **)error
+{
+  // Feed the data in small chunks as a connection would.
+  NSMutableData *output = [NSMutableData data];
+  for (NSUInteger offset = 0; offset < [data length]; offset += 7) {
+    NSData *chunk = [data subdataWithRange:NSMakeRange(offset, MIN(7, [data length] - offset))];
+    NSData *result = [transform transformData:chunk error:error];
+    if (result == nil) {
+      return nil;
+    }
+    [output appendData:result];
+  }
+  NSData *result = [transform finishWithError:error];
+  if (result == nil) {
+    return nil;
+  }
+  [output appendData:result];
+  return output;
+}
+
+- (void)testTransformChainDecryptsInflatesAndVerifies
+{
+  NSData *payload = ISCacheTestJSONPayload();
+  
+  // Compress and then encrypt the payload.
+  ISCacheCodec *compressor = [ISCacheCodec compressorWithCompression:ISCacheCompressionDefault];
+  NSMutableData *compressed = [[compressor processData:payload] mutableCopy];
+  [compressed appendData:[compressor finish]];
+  NSMutableData *key = [NSMutableData dataWithLength:kCCKeySizeAES128];
+  NSMutableData *iv = [NSMutableData dataWithLength:kCCBlockSizeAES128];
+  NSMutableData *encrypted = [NSMutableData dataWithLength:[compressed length] + kCCBlockSizeAES128];
+  size_t encryptedLength = 0;
+  CCCrypt(kCCEncrypt, kCCAlgorithmAES128, kCCOptionPKCS7Padding,
+          [key bytes], [key length], [iv bytes],
+          [compressed bytes], [compressed length],
+          [encrypted mutableBytes], [encrypted length], &encryptedLength);
+  [encrypted setLength:encryptedLength];
+  
+  NSMutableData *expectedDigest = [NSMutableData dataWithLength:CC_SHA256_DIGEST_LENGTH];
+  CC_SHA256([payload bytes], (CC_LONG)[payload length], [expectedDigest mutableBytes]);
+  
+  ISCacheByteCountTransform *counter = [ISCacheByteCountTransform new];
+  ISCacheTransformChain *chain =
+  [ISCacheTransformChain chainWithTransforms:@[[[ISCacheDecryptTransform alloc] initWithKey:key iv:iv],
+                                               [ISCacheInflateTransform new],
+                                               [[ISCacheDigestTransform alloc] initWithAlgorithm:ISCacheDigestAlgorithmSHA256
+                                                                                  expectedDigest:expectedDigest],
+                                               counter]];
+  NSError *error;
+  NSData *output = [self transformData:encrypted
+                         withTransform:chain
+                                 error:&error];
+  XCTAssertEqualObjects(output, payload,
+                        @"Check that the chain restores the payload (%@).", error);
+  XCTAssertEqual(counter.count, [payload length],
+                 @"Check that the byte count reflects the final data.");
+  
+  // Verification fails for unexpected data.
+  ISCacheDigestTransform *digest =
+  [[ISCacheDigestTransform alloc] initWithAlgorithm:ISCacheDigestAlgorithmSHA256
+                                     expectedDigest:expectedDigest];
+  output = [self transformData:ISCacheTestRandomPayload()
+                 withTransform:digest
+                         error:&error];
+  XCTAssertNil(output,
+               @"Check that digest verification rejects unexpected data.");
+  XCTAssertEqual(error.code, ISCacheErrorVerificationFailed,
+                 @"Check the verification error.");
+}
+
+- (ISCacheTestUpdater *)receiveData:(NSData *)data
+                            forItem:(ISCacheItem *)item
+                            handler:(ISCacheHTTPHandler *)handler
+{
+  ISCacheTestUpdater *updater = [ISCacheTestUpdater new];
+  [handler setCacheItem:item];
+  [handler setUpdater:updater];
+  
+  // The handler only records the expected length for requests it
+  // starts itself.
+  NSURLResponse *response = [[NSURLResponse alloc] initWithURL:[NSURL URLWithString:item.identifier]
+                                                      MIMEType:@"application/json"
+                                         expectedContentLength:[data length]
+                                              textEncodingName:nil];
+  item.totalBytesExpectedToRead = [data length];
+  [handler connection:nil didReceiveResponse:response];
+  for (NSUInteger offset = 0; offset < [data length]; offset += 1024) {
+    [handler connection:nil
+         didReceiveData:[data subdataWithRange:NSMakeRange(offset, MIN(1024, [data length] - offset))]];
+  }
+  [handler connectionDidFinishLoading:nil];
+  return updater;
+}
+
+- (void)testTransformHandlerFactoryBuildsTransformPerHandler
+{
+  NSData *payload = ISCacheTestJSONPayload();
+  NSMutableData *expectedDigest = [NSMutableData dataWithLength:CC_SHA256_DIGEST_LENGTH];
+  CC_SHA256([payload bytes], (CC_LONG)[payload length], [expectedDigest mutableBytes]);
+  
+  __block NSInteger transforms = 0;
+  ISCacheTransformHandlerFactory *factory =
+  [ISCacheTransformHandlerFactory factoryWithTransformBlock:^(NSString *context, NSDictionary *userInfo) {
+    transforms++;
+    return [[ISCacheDigestTransform alloc] initWithAlgorithm:ISCacheDigestAlgorithmSHA256
+                                              expectedDigest:expectedDigest];
+  }];
+  
+  ISCacheItem *item = [self.cache itemForIdentifier:@"https://www.example.com/verified.json"
+                                            context:kTestContext
+                                        preferences:nil];
+  ISCacheTestUpdater *updater =
+  [self receiveData:payload
+            forItem:item
+            handler:(ISCacheHTTPHandler *)[factory handlerForContext:kTestContext
+                                                            userInfo:nil]];
+  XCTAssertTrue(updater.finished,
+                @"Check that verified downloads finish (%@).", updater.error);
+  XCTAssertEqualObjects([item existingFile:@"verified.json"].data, payload,
+                        @"Check that transformed data is written to the item's file.");
+  
+  // Verification fails for unexpected data.
+  ISCacheItem *corruptItem = [self.cache itemForIdentifier:@"https://www.example.com/corrupt.json"
+                                                   context:kTestContext
+                                               preferences:nil];
+  updater =
+  [self receiveData:ISCacheTestRandomPayload()
+            forItem:corruptItem
+            handler:(ISCacheHTTPHandler *)[factory handlerForContext:kTestContext
+                                                            userInfo:nil]];
+  XCTAssertFalse(updater.finished,
+                 @"Check that unverified downloads do not finish.");
+  XCTAssertEqual(updater.error.code, ISCacheErrorVerificationFailed,
+                 @"Check that transform failures are reported.");
+  XCTAssertEqual(transforms, 2,
+                 @"Check that each handler has its own transform.");
+}
+
+- (void)testLayoutMigrationMovesItems
+{
+  ISCacheItem *item = [self.cache itemForIdentifier:@"migrated"
+                                            context:kTestContext
+                                        preferences:nil];
+  [item fetch];
+  [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:1.0]];
+  XCTAssertEqual(item.state, ISCacheItemStateFound,
+                 @"Check that the item is fetched before migrating.");
+  NSString *uid = item.uid;
+  NSString *flatPath = item.file.path;
+  NSData *data = item.file.data;
+  
+  self.cache.layout = ISCacheLayoutSharded;
+  [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.1]];
+  NSString *shardedPath = item.file.path;
+  XCTAssertTrue([shardedPath rangeOfString:ISCachePathForUid(uid, ISCacheLayoutSharded)].location != NSNotFound,
+                @"Check that the item is moved into the sharded layout.");
+  XCTAssertFalse([[NSFileManager defaultManager] fileExistsAtPath:flatPath],
+                 @"Check that nothing is left at the previous path.");
+  XCTAssertEqualObjects(item.file.data, data,
+                        @"Check that the item's data survives the move.");
+  
+  // Reopening the cache reconciles nested directories without
+  // mistaking the moved item for an orphan.
+  [self closeCache];
+  ISCacheItem *reopened = [self.cache itemForUid:uid];
+  [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:1.0]];
+  XCTAssertEqual(reopened.state, ISCacheItemStateFound,
+                 @"Check that the moved item is still found.");
+  XCTAssertEqualObjects(reopened.file.path, shardedPath,
+                        @"Check that the new path is persisted.");
+  XCTAssertEqualObjects(reopened.file.data, data,
+                        @"Check that the moved item's data is readable.");
+}
+
+- (void)testLayoutMigrationMovesFetchingItemsOnCompletion
+{
+  ISCacheItem *item = [self.cache itemForIdentifier:@"fetching"
+                                            context:kTestContext
+                                        preferences:nil];
+  [item fetch];
+  [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.15]];
+  XCTAssertEqual(item.state, ISCacheItemStateInProgress,
+                 @"Check that the item is being fetched when migrating.");
+  
+  self.cache.layout = ISCacheLayoutSharded;
+  [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:1.0]];
+  XCTAssertEqual(item.state, ISCacheItemStateFound,
+                 @"Check that the fetch completes.");
+  XCTAssertTrue([item.file.path rangeOfString:ISCachePathForUid(item.uid, ISCacheLayoutSharded)].location != NSNotFound,
+                @"Check that the item is moved once its fetch completes.");
+  XCTAssertEqual([item.file.data length], [kTestChunk length] * kTestChunkCount,
+                 @"Check that the moved item's data is complete.");
+}
+
+- (void)testLayoutMigrationSkipsCancelledItems
+{
+  ISCacheItem *item = [self.cache itemForIdentifier:@"cancelled"
+                                            context:kTestContext
+                                        preferences:nil];
+  [item fetch];
+  [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.15]];
+  
+  self.cache.layout = ISCacheLayoutSharded;
+  [self.cache cancelItems:@[item]];
+  [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.5]];
+  
+  NSString *applicationSupport = [NSSearchPathForDirectoriesInDomains(NSApplicationSupportDirectory, NSUserDomainMask, YES) objectAtIndex:0];
+  NSString *sharded = [NSString pathWithComponents:@[applicationSupport, @"Cache", kCacheIdentifier, ISCachePathForUid(item.uid, ISCacheLayoutSharded)]];
+  XCTAssertEqual(item.state, ISCacheItemStateNotFound,
+                 @"Check that the fetch is cancelled.");
+  XCTAssertFalse([[NSFileManager defaultManager] fileExistsAtPath:sharded],
+                 @"Check that cancelled items are not moved into the new layout.");
+}
+
+- (void)testRejectedItemsDeliveredThenRemoved
+{
+  self.cache.diskBudget = 10;
+  ISCacheItem *item = [self.cache itemForIdentifier:@"rejected"
+                                            context:kTestContext
+                                        preferences:nil];
+  __block BOOL delivered = NO;
+  [item then:^(NSError *error, ISCancelToken *cancelToken) {
+    delivered = (error == nil &&
+                 item.transient &&
+                 [item.file.data length] == [kTestChunk length] * kTestChunkCount);
+  }];
+  [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:1.0]];
+  
+  XCTAssertTrue(delivered,
+                @"Check that items exceeding the budget are delivered as transient items.");
+  XCTAssertEqual(item.state, ISCacheItemStateNotFound,
+                 @"Check that transient items are removed once delivered.");
+}
+
+- (void)testRejectedItemsReadableWhileInterestHeld
+{
+  self.cache.diskBudget = 10;
+  ISCacheItem *item = [self.cache itemForIdentifier:@"rejected-async"
+                                            context:kTestContext
+                                        preferences:nil];
+  
+  // Read the data later on another queue, as image views do, holding
+  // an interest until the read completes.
+  __block NSUInteger length = 0;
+  [item then:^(NSError *error, ISCancelToken *cancelToken) {
+    [item addInterest];
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(0.2 * NSEC_PER_SEC)), dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+      NSUInteger readLength = [item.file.data length];
+      dispatch_async(dispatch_get_main_queue(), ^{
+        length = readLength;
+        [item removeInterest];
+      });
+    });
+  }];
+  [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:1.0]];
+  
+  XCTAssertEqual(length, [kTestChunk length] * kTestChunkCount,
+                 @"Check that transient items remain readable while interest is held.");
+  XCTAssertEqual(item.state, ISCacheItemStateNotFound,
+                 @"Check that transient items are removed once interest is released.");
+}
+
+- (void)testDiskUsageAndAccessTimesPersist
+{
+  [self.cache registerFactory:[ISCacheSimpleHandlerFactory factoryWithClass:[ISCacheSizedTestHandler class]]
+                   forContext:kSizedTestContext];
+  [self requestSizedItem:@"first" length:100];
+  [self requestSizedItem:@"second" length:200];
+  XCTAssertEqual(self.cache.usedBytes, 300,
+                 @"Check that found items are counted against the disk budget.");
+  
+  ISCacheItem *item = [self.cache itemForIdentifier:@"first"
+                                            context:kSizedTestContext
+                                        preferences:@{@"length": @100}];
+  NSString *uid = item.uid;
+  NSTimeInterval accessed = [item.accessed timeIntervalSince1970];
+  
+  [self closeCache];
+  ISCacheItem *reopenedItem = [self.cache itemForUid:uid];
+  XCTAssertEqualWithAccuracy([reopenedItem.accessed timeIntervalSince1970], accessed, 0.001,
+                             @"Check that access times persist across cache instances.");
+  XCTAssertEqual(self.cache.usedBytes, 300,
+                 @"Check that disk usage is restored when the cache is opened.");
+  
+  [self.cache removeItem:reopenedItem];
+  XCTAssertEqual(self.cache.usedBytes, 200,
+                 @"Check that removed items are no longer counted.");
+}
+
+- (BOOL)requestSizedItem:(NSString *)identifier
+                  length:(NSUInteger)length
+{
+  return [ISCacheSizedTestHandler requestItem:identifier
+                                       length:length
+                                      context:kSizedTestContext
+                                        cache:self.cache];
+}
+
+// Spins the run loop until the item reaches the state, returning NO
+// if the timeout elapses first.
+- (BOOL)waitForItem:(ISCacheItem *)item
+              state:(ISCacheItemState)state
+            timeout:(NSTimeInterval)timeout
+{
+  NSDate *deadline = [NSDate dateWithTimeIntervalSinceNow:timeout];
+  while (item.state != state &&
+         [deadline timeIntervalSinceNow] > 0) {
+    [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.01]];
+  }
+  return item.state == state;
+}
+
+- (void)testPrefetcherFetchesLikelySuccessors
+{
+  ISCachePrefetcher *prefetcher = [ISCachePrefetcher prefetcher];
+  prefetcher.manager = [ISCacheManager new];
+  self.cache.prefetcher = prefetcher;
+  
+  // Teach the prefetcher that 'first' is followed by 'second'; requests
+  // are recorded without the items being fetched.
+  [self.cache itemForIdentifier:@"first"
+                        context:kTestContext
+                    preferences:nil];
+  ISCacheItem *second = [self.cache itemForIdentifier:@"second"
+                                              context:kTestContext
+                                          preferences:nil];
+  NSDate *accessed = second.accessed;
+  
+  [self.cache itemForIdentifier:@"first"
+                        context:kTestContext
+                    preferences:nil];
+  XCTAssertTrue([self waitForItem:second
+                            state:ISCacheItemStateFound
+                          timeout:5.0],
+                @"Check that the likely successor is prefetched.");
+  XCTAssertEqualObjects(second.accessed, accessed,
+                        @"Check that prefetches are not recorded as requests.");
+  XCTAssertEqual(prefetcher.prefetches, 1,
+                 @"Check that the prefetch is counted.");
+  
+  [self.cache itemForIdentifier:@"second"
+                        context:kTestContext
+                    preferences:nil];
+  XCTAssertEqual(prefetcher.hits, 1,
+                 @"Check that requests for prefetched items are counted as hits.");
+  XCTAssertEqual(prefetcher.precision, 1.0,
+                 @"Check the precision of the prefetcher.");
+}
+
+- (void)testPrefetcherBoundsAndForgetsTransitions
+{
+  ISCachePrefetcher *prefetcher = [ISCachePrefetcher prefetcher];
+  prefetcher.budget = 10;
+  prefetcher.minimumConfidence = 0.0;
+  prefetcher.maximumSuccessors = 2;
+  self.cache.prefetcher = prefetcher;
+  
+  ISCacheItem *first = nil;
+  ISCacheItem *successor = nil;
+  for (NSString *identifier in @[@"a", @"b", @"c"]) {
+    first = [self.cache itemForIdentifier:@"first"
+                                  context:kTestContext
+                              preferences:nil];
+    successor = [self.cache itemForIdentifier:identifier
+                                      context:kTestContext
+                                  preferences:nil];
+  }
+  
+  NSArray *predictions = [prefetcher predictionsForItem:first];
+  XCTAssertEqual(predictions.count, 2,
+                 @"Check that only the maximum number of successors are kept.");
+  XCTAssertTrue([predictions containsObject:successor],
+                @"Check that the most recent successor is kept.");
+  
+  [self.cache removeItems:@[successor]];
+  XCTAssertFalse([[prefetcher predictionsForItem:first] containsObject:successor],
+                 @"Check that the transitions of removed items are forgotten.");
+  
+  [self.cache removeItems:@[first]];
+  XCTAssertEqual([prefetcher predictionsForItem:first].count, 0,
+                 @"Check that the transitions from removed items are forgotten.");
+}
+
+- (void)testOrphanedDirectoriesReclaimed
+{
+  NSString *applicationSupport = [NSSearchPathForDirectoriesInDomains(NSApplicationSupportDirectory, NSUserDomainMask, YES) objectAtIndex:0];
+  NSString *orphan = [NSString pathWithComponents:@[applicationSupport, @"Cache", kCacheIdentifier, @"orphan"]];
+  
+  // Ensure the cache exists before introducing the orphan.
+  [self.cache allItems];
+  [self closeCache];
+  [[NSFileManager defaultManager] createDirectoryAtPath:orphan
+                            withIntermediateDirectories:YES
+                                             attributes:nil
+                                                  error:nil];
+  
+  [self.cache allItems];
+  [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:1.0]];
+  
+  XCTAssertFalse([[NSFileManager defaultManager] fileExistsAtPath:orphan],
+                 @"Check that orphaned item directories are reclaimed at launch.");
+}
+
+- (void)testCompressedFilesReadBackTransparently
+{
+  NSString *directory = [NSTemporaryDirectory() stringByAppendingPathComponent:@"compression"];
+  NSData *payload = ISCacheTestJSONPayload();
+  ISCacheFile *file = [[ISCacheFile alloc] initWithDirectory:directory
+                                                    filename:@"json"
+                                                 compression:ISCacheCompressionDefault
+                                                      length:0];
+  [file remove];
+  for (NSUInteger offset = 0; offset < [payload length]; offset += 16 * 1024) {
+    NSRange range = NSMakeRange(offset, MIN(16 * 1024, [payload length] - offset));
+    [file appendData:[payload subdataWithRange:range]];
+  }
+  [file close];
+  
+  XCTAssertEqualObjects([file data], payload,
+                        @"Check that compressed files are read back transparently.");
+  XCTAssertEqual(file.length, [payload length],
+                 @"Check that the logical length of compressed files is recorded.");
+  XCTAssertTrue(file.storedLength < file.length,
+                @"Check that text payloads are compressed.");
+  [file remove];
+}
+
+- (void)testFilesWrittenByPathBypassCompression
+{
+  [self.cache setCompression:ISCacheCompressionDefault
+                  forContext:kTestContext];
+  ISCacheItem *item = [self.cache itemForIdentifier:@"path"
+                                            context:kTestContext
+                                        preferences:nil];
+  NSData *payload = ISCacheTestJSONPayload();
+  
+  ISCacheFile *file = [item file:@"download"
+                     compression:ISCacheCompressionNone];
+  [[NSFileManager defaultManager] createDirectoryAtPath:[file.path stringByDeletingLastPathComponent]
+                            withIntermediateDirectories:YES
+                                             attributes:nil
+                                                  error:nil];
+  [payload writeToFile:file.path
+            atomically:YES];
+  
+  XCTAssertEqual([item file:@"download"], file,
+                 @"Check that existing files keep their compression.");
+  XCTAssertEqualObjects(file.data, payload,
+                        @"Check that files written by path are read back unchanged.");
+  XCTAssertEqual(file.length, [payload length],
+                 @"Check that files written by path record their length.");
+}
+
+- (void)testBackgroundHandlerMovesDownloadIntoItem
+{
+  NSURLSessionConfiguration *configuration = [NSURLSessionConfiguration defaultSessionConfiguration];
+  ISCacheBackgroundSession *session = [[ISCacheBackgroundSession alloc] initWithConfiguration:configuration];
+  [self.cache registerFactory:[ISCacheBackgroundHandlerFactory factoryWithSession:session]
+                   forContext:@"Background"];
+  
+  ISCacheItem *item = [self.cache itemForIdentifier:kDownloadURL
+                                            context:@"Background"
+                                        preferences:nil];
+  [item fetch];
+  [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:5.0]];
+  
+  XCTAssertEqual(item.state, ISCacheItemStateFound,
+                 @"Check that background transfers complete.");
+  XCTAssertTrue(item.file.length > 0,
+                @"Check that the download is moved into the item.");
+  XCTAssertEqual(item.file.length, item.totalBytesRead,
+                 @"Check that the item records the length of the download.");
+  
+  // Simulate a relaunch.
+  NSString *uid = item.uid;
+  NSData *data = item.file.data;
+  [session invalidate];
+  [self closeCache];
+  ISCacheItem *relaunchedItem = [self.cache itemForUid:uid];
+  
+  XCTAssertEqual(relaunchedItem.state, ISCacheItemStateFound,
+                 @"Check that background transfers persist across launches.");
+  XCTAssertEqualObjects(relaunchedItem.file.data, data,
+                        @"Check that background transfer files persist across launches.");
+}
+
+- (void)testBackgroundSessionAdoptsOutstandingTransfers
+{
+  NSURLSessionConfiguration *configuration = [NSURLSessionConfiguration defaultSessionConfiguration];
+  ISCacheBackgroundSession *previousSession = [[ISCacheBackgroundSession alloc] initWithConfiguration:configuration];
+  [self.cache registerFactory:[ISCacheBackgroundHandlerFactory factoryWithSession:previousSession]
+                   forContext:@"Background"];
+  
+  // Start a transfer and leave it outstanding.
+  ISCacheItem *item = [self.cache itemForIdentifier:kDownloadURL
+                                            context:@"Background"
+                                        preferences:nil];
+  NSString *uid = item.uid;
+  NSURLSessionDownloadTask *task =
+  [previousSession downloadTaskForItem:item
+                               handler:[[ISCacheBackgroundHandler alloc] initWithSession:previousSession]];
+  [previousSession removeTask:task];
+  
+  // Simulate a relaunch; the new session has no handler for the task.
+  [self closeCache];
+  ISCacheBackgroundSession *session = [[ISCacheBackgroundSession alloc] initWithConfiguration:configuration];
+  [self.cache registerFactory:[ISCacheBackgroundHandlerFactory factoryWithSession:session]
+                   forContext:@"Background"];
+  ISCacheBackgroundHandler *handler = [session _handlerForTask:task];
+  ISCacheItem *relaunchedItem = [self.cache itemForUid:uid];
+  
+  XCTAssertNotNil(handler,
+                  @"Check that outstanding transfers are reattached.");
+  XCTAssertEqual(relaunchedItem.state, ISCacheItemStateInProgress,
+                 @"Check that items with outstanding transfers are adopted.");
+  XCTAssertFalse([self.cache _adoptItem:relaunchedItem
+                                handler:handler],
+                 @"Check that adopted items are active.");
+  XCTAssertEqual([session _handlerForTask:task], handler,
+                 @"Check that outstanding transfers are only adopted once.");
+  
+  [handler cancel];
+  XCTAssertEqual(relaunchedItem.state, ISCacheItemStateNotFound,
+                 @"Check that adopted transfers can be cancelled.");
+}
+
+- (void)testConcurrencyControllerRespectsBounds
+{
+  ISCacheConcurrencyController *controller =
+  [[ISCacheConcurrencyController alloc] initWithLimit:2
+                                         minimumLimit:1
+                                         maximumLimit:4];
+  ISCacheItem *item = [self.cache itemForIdentifier:kDownloadURL
+                                            context:ISCacheURLContext
+                                        preferences:nil];
+  
+  // Steady windows of fetches should grow the limit additively up to
+  // the configured maximum.
+  for (NSInteger i = 0; i < 20; i++) {
+    [controller fetchDidStart:item];
+    [controller fetchDidFinish:item];
+  }
+  
+  XCTAssertEqual(controller.limit, 4,
+                 @"Check that the concurrency limit does not exceed the maximum.");
+}
+
+- (void)testConcurrencyControllerHalvesLimitWhenLatencyRises
+{
+  ISCacheConcurrencyController *controller =
+  [[ISCacheConcurrencyController alloc] initWithLimit:4
+                                         minimumLimit:1
+                                         maximumLimit:4];
+  __block NSTimeInterval now = 0;
+  controller.clock = ^{
+    return [NSDate dateWithTimeIntervalSinceReferenceDate:now];
+  };
+  NSMutableArray *items = [NSMutableArray array];
+  for (NSInteger i = 0; i < 4; i++) {
+    [items addObject:[self.cache itemForIdentifier:[NSString stringWithFormat:@"%ld", (long)i]
+                                           context:kTestContext
+                                       preferences:nil]];
+  }
+  
+  // Establish a baseline with a window of fast fetches.
+  for (ISCacheItem *item in items) {
+    [controller fetchDidStart:item];
+  }
+  now += 0.1;
+  for (ISCacheItem *item in items) {
+    [controller fetchDidFinish:item];
+  }
+  XCTAssertEqual(controller.limit, 4,
+                 @"Check that fast fetches do not reduce the limit.");
+  
+  // Each window of slow fetches should halve the limit until the
+  // baseline has caught up with the new latency, at which point the
+  // limit is free to grow again.
+  NSArray *expected = @[@2, @1, @1, @2];
+  for (NSNumber *limit in expected) {
+    NSArray *window = [items subarrayWithRange:NSMakeRange(0, controller.limit)];
+    for (ISCacheItem *item in window) {
+      [controller fetchDidStart:item];
+    }
+    now += 1.0;
+    for (ISCacheItem *item in window) {
+      [controller fetchDidFinish:item];
+    }
+    XCTAssertEqual(controller.limit, [limit unsignedIntegerValue],
+                   @"Check that rising latency halves the limit without pinning it at the minimum.");
+  }
+}
+
+- (void)testConcurrencyControllerForgetsCancelledFetches
+{
+  ISCacheConcurrencyController *controller =
+  [[ISCacheConcurrencyController alloc] initWithLimit:1
+                                         minimumLimit:1
+                                         maximumLimit:4];
+  ISCacheItem *item = [self.cache itemForIdentifier:@"cancelled"
+                                            context:kTestContext
+                                        preferences:nil];
+  
+  [controller fetchDidStart:item];
+  [controller fetchDidCancel:item];
+  XCTAssertFalse([controller fetchDidFinish:item],
+                 @"Check that cancelled fetches are not measured.");
+  XCTAssertEqual(controller.limit, 1,
+                 @"Check that cancelled fetches do not complete a window.");
+}
+
 @end
@@ -0,0 +1,134 @@
+//
+// Copyright (c) 2013-2014 InSeven Limited.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+// Builds a pack file for mounting with -[ISCache mountPackAtPath:error:]
+// from a JSON manifest, allowing assets shipped with an application to
+// be found on first launch without being fetched.
+//
+// The manifest is an array of entries of the form:
+//
+//   {
+//     "identifier": "http://www.example.com/image.png",
+//     "context": "Image",
+//     "preferences": {"width": 152, "height": 152},
+//     "file": "Assets/image.png",
+//     "filename": "image.png"
+//   }
+//
+// preferences and filename are optional; files are relative to the
+// manifest and filename defaults to the last path component of file.
+//
+// Usage: ispack manifest.json output.pack
+//
+// Build with the ISCache sources and the NSString-Hashes pod:
+//
+//   clang -fobjc-arc -framework Foundation -I Classes -I <NSString-Hashes> \
+//     Tools/ISCachePack/main.m Classes/ISCachePackWriter.m \
+//     Classes/ISCacheUid.m <NSString-Hashes>/NSString+Hashes.m -o ispack
+
+#import <Foundation/Foundation.h>
+#import "ISCachePackWriter.h"
+
+int main(int argc, const char *argv[])
+{
+  @autoreleasepool {
+    
+    if (argc != 3) {
+      fprintf(stderr, "usage: ispack manifest.json output.pack\n");
+      return 1;
+    }
+    
+    NSString *manifestPath = [NSString stringWithUTF8String:argv[1]];
+    NSString *outputPath = [NSString stringWithUTF8String:argv[2]];
+    NSString *root = [manifestPath stringByDeletingLastPathComponent];
+    
+    NSError *error;
+    NSData *manifestData = [NSData dataWithContentsOfFile:manifestPath
+                                                  options:0
+                                                    error:&error];
+    NSArray *manifest =
+    manifestData
+    ? [NSJSONSerialization JSONObjectWithData:manifestData
+                                      options:0
+                                        error:&error]
+    : nil;
+    if (![manifest isKindOfClass:[NSArray class]]) {
+      fprintf(stderr, "ispack: unable to read manifest %s: %s\n",
+              argv[1],
+              [[error localizedDescription] UTF8String]);
+      return 1;
+    }
+    
+    ISCachePackWriter *writer = [ISCachePackWriter new];
+    for (NSDictionary *entry in manifest) {
+      NSString *identifier = entry[@"identifier"];
+      NSString *context = entry[@"context"];
+      NSString *file = entry[@"file"];
+      if (identifier == nil ||
+          context == nil ||
+          file == nil) {
+        fprintf(stderr, "ispack: invalid entry %s\n",
+                [[entry description] UTF8String]);
+        return 1;
+      }
+      
+      NSString *path =
+      [file isAbsolutePath]
+      ? file
+      : [root stringByAppendingPathComponent:file];
+      NSData *data = [NSData dataWithContentsOfFile:path
+                                            options:NSDataReadingMappedIfSafe
+                                              error:&error];
+      if (data == nil) {
+        fprintf(stderr, "ispack: unable to read %s: %s\n",
+                [path UTF8String],
+                [[error localizedDescription] UTF8String]);
+        return 1;
+      }
+      
+      NSString *filename = entry[@"filename"];
+      if (filename == nil) {
+        filename = [file lastPathComponent];
+      }
+      
+      [writer addData:data
+             filename:filename
+        forIdentifier:identifier
+              context:context
+          preferences:entry[@"preferences"]];
+    }
+    
+    if (![writer writeToPath:outputPath
+                       error:&error]) {
+      fprintf(stderr, "ispack: unable to write %s: %s\n",
+              argv[2],
+              [[error localizedDescription] UTF8String]);
+      return 1;
+    }
+    
+    printf("ispack: wrote %lu items to %s\n",
+           (unsigned long)writer.count,
+           argv[2]);
+    
+  }
+  return 0;
+}